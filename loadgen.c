@@ -0,0 +1,115 @@
+#define _GNU_SOURCE  // clock_nanosleep under -std=c99.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// Appends timestamped chat lines to a log for tc --latency to measure.
+// Every line starts with "loadgen@<CLOCK_MONOTONIC ns>#<seq>:", taken just before it is written.
+
+#define MAX_LINE 1024
+
+const char* words[] = {
+    "the", "quick", "brown", "fox", "jumps", "over", "a", "lazy", "dog", "while", "chat", "scrolls",
+    "past", "with", "some", "longer", "words", "like", "internationalization", "and", "ok", "lol",
+};
+#define NUM_WORDS (int)(sizeof(words) / sizeof(words[0]))
+
+uint32_t rng_state = 1;
+
+// xorshift32: same seed, same lines.
+uint32_t next_random() {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+int64_t monotonic_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+void sleep_until(int64_t deadline_ns) {
+    struct timespec ts = {(time_t)(deadline_ns / 1000000000), (long)(deadline_ns % 1000000000)};
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {}
+}
+
+// One line per write(), so tc never sees half a line.
+int append_line(int fd, uint64_t seq, int max_words) {
+    char line[MAX_LINE];
+    int len = snprintf(line, sizeof(line), "loadgen@%lld#%llu:", (long long)monotonic_ns(), (unsigned long long)seq);
+    int num_words = 1 + (int)(next_random() % (uint32_t)max_words);
+    for (int i = 0; i < num_words && len < MAX_LINE - 32; i++) {
+        len += snprintf(line + len, sizeof(line) - len, " %s", words[next_random() % NUM_WORDS]);
+    }
+    line[len++] = '\n';
+    if (write(fd, line, len) != len) {
+        fprintf(stderr, "Write failed: %s\n", strerror(errno));
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    // Usage: loadgen [--rate N] [--burst N] [--burst-every S] [--duration S] [--words N] [--seed N] log.txt
+    double rate = 10;         // Steady lines per second; 0 for bursts only.
+    int burst = 0;            // Extra lines written back to back...
+    double burst_every = 5;   // ...every this many seconds.
+    double duration = 10;
+    int max_words = 30;
+    const char* path = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--rate") == 0 && i + 1 < argc) rate = atof(argv[++i]);
+        else if (strcmp(argv[i], "--burst") == 0 && i + 1 < argc) burst = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--burst-every") == 0 && i + 1 < argc) burst_every = atof(argv[++i]);
+        else if (strcmp(argv[i], "--duration") == 0 && i + 1 < argc) duration = atof(argv[++i]);
+        else if (strcmp(argv[i], "--words") == 0 && i + 1 < argc) max_words = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) rng_state = (uint32_t)strtoul(argv[++i], NULL, 0);
+        else path = argv[i];
+    }
+    if (!path || rate < 0 || burst < 0 || burst_every <= 0 || duration <= 0 || max_words < 1) {
+        fprintf(stderr, "Usage: loadgen [--rate N] [--burst N] [--burst-every S] [--duration S] [--words N] [--seed N] log.txt\n");
+        return 1;
+    }
+    if (rng_state == 0) rng_state = 1;
+
+    int fd = open(path, O_WRONLY | O_APPEND | O_CREAT, 0644);
+    if (fd < 0) {
+        fprintf(stderr, "Log %s: %s\n", path, strerror(errno));
+        return 1;
+    }
+
+    // Steady lines and bursts each keep their own schedule, measured from the start.
+    int64_t start = monotonic_ns();
+    int64_t end = start + (int64_t)(duration * 1e9);
+    int64_t line_period = rate > 0 ? (int64_t)(1e9 / rate) : 0;
+    int64_t burst_period = (int64_t)(burst_every * 1e9);
+    int64_t next_line = start;
+    int64_t next_burst = burst > 0 ? start + burst_period : INT64_MAX;
+    uint64_t seq = 0;
+    int status = 0;
+    for (;;) {
+        int64_t next = (line_period && next_line < next_burst) ? next_line : next_burst;
+        if (next >= end) break;
+        sleep_until(next);
+        if (next == next_burst) {
+            for (int i = 0; i < burst && status == 0; i++) status = append_line(fd, seq++, max_words);
+            next_burst += burst_period;
+        } else {
+            status = append_line(fd, seq++, max_words);
+            next_line += line_period;
+        }
+        if (status != 0) break;
+    }
+    close(fd);
+    printf("%llu lines in %.1f s\n", (unsigned long long)seq, (monotonic_ns() - start) / 1e9);
+    return status;
+}
@@ -1,3 +1,4 @@
+#define _GNU_SOURCE  // fileno, pread, memrchr, inotify under -std=c99.
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_ttf.h>
 #include <stdio.h>
@@ -7,6 +8,19 @@
 #include <sys/stat.h>
 #include <time.h>
 #include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <limits.h>
+#include <stdint.h>
+#include <glob.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
 
 #if 0
 #define WW 2560
@@ -21,29 +35,98 @@
 #endif
 
 #define DELAY 10
+#define IDLE_POLL_MS 250  // Longest idle sleep between log polls (stat fallback only).
+#define TAIL_READ_BLOCK (64 * 1024)  // Bytes read at a time scanning back from EOF for the tail.
+#define TAIL_CHECK_LEN 32  // Bytes before a source's position re-read to spot truncate-and-rewrite.
+#define MAX_STAMP 32  // Longest leading timestamp compared by --merge time.
+#define SOURCE_COLORS 6  // Speaker colors handed out to the second and later logs.
+#define LINE_BUFFER 1024  // Longest log line kept in one entry, with its terminator; longer lines are split.
+#define ARENA_CHUNK_SIZE (64 * 1024)
+#define ARENA_SPARE_CHUNKS 8  // Empty chunks kept for reuse instead of going back to malloc.
+#define INGEST_RING_SIZE 4096  // Entries in flight from the ingest thread; power of two.
+#define HISTORY_PAGE_LINES 1024  // Log lines per page read back from the log.
+#define HISTORY_MAX_LINES (4 * HISTORY_PAGE_LINES)  // Entries above chat_log kept before a page is dropped.
+#define HISTORY_READ_AHEAD 256  // Entries left before the edge of the paged-in history when the next page is asked for.
 
 #define DEBUG false
 
-#define MAX_ENTRIES 50
+#define MAX_ENTRIES 50  // Default scrollback (--scrollback).
+#define MAX_SCROLLBACK (1 << 24)  // Largest --scrollback: the ring, its height tree and hash tables stay within int sizes.
 #define MARGIN_X 7
 #define MARGIN_Y 5
 #define LINE_HEIGHT 20
-#define MAX_WRAP_WIDTH (WW - 2 * MARGIN_X)
+#define MAX_WRAP_WIDTH (WW - 2 * MARGIN_X)  // Initial wrap_width, and the one --bench-wrap uses.
+#define REWRAP_MAX_WORKERS 4
 #define SPACE_ADVANCE 7
-
-float RATE = 20;
+#define POINT_BATCH_SIZE 4096
+#define JITTER_VISIBLE 2.0f  // Below this RATE every jitter offset truncates to 0.
+#define RATE_SETTLED 1.1f  // RATE decays to this and stops.
+#define RATE_DECAY 18.0f  // RATE shed per second: RATE_RESET settles in about a second.
+#define FADE_IN_TIME 0.3f  // Seconds a new entry takes to fade in, well before its jitter settles.
+#define MAX_FRAME_TIME 0.1f  // Longest step the animation clock takes, so a stall doesn't skip the animation.
+#define TARGET_FPS 60  // Default --fps; 0 leaves frame pacing to vsync.
+#define MAX_FPS 1000  // Largest --fps.
+#define JITTER_BATCH 4096  // Offset pairs made per jitter_fill; a multiple of 4.
+#define JITTER_SEED 1  // Default --seed.
+#define ATLAS_COLUMNS 16
+#define GLYPH_THRESHOLD 50  // Glyph pixels with alpha above this are kept (AA edges).
+#define GLYPH_CACHE_VERSION 1
+#define MIN_FONT_SIZE 6  // Zoom limits (+/- keys).
+#define MAX_FONT_SIZE 96
+#define ZOOM_STEP 2
+#define UNICODE_GLYPHS 1024   // Non-ASCII glyphs kept at once; least recently used go first.
+#define UNICODE_BUCKETS 2048
+#define LINE_CACHE_MB 64  // Default cap on cached entry textures (--cache-mb).
+#define BENCH_FRAMES 600  // Default --bench-frames.
+#define BENCH_LINES_PER_FRAME 2  // Replayed log lines arriving each --bench frame.
+#define BENCH_FRAME_TIME (1.0f / 60)  // Animation step per --bench frame, whatever the frame took.
+#define PROFILE_SAMPLES 256  // Frames kept for the profiler HUD (p key).
+#define LATENCY_TAG "loadgen@"  // Lines from loadgen start with this, then their append time in ns.
+#define LATENCY_BUCKETS 12  // Histogram rows, doubling from 1 ms.
+#define PALETTE_SIZE 16  // Colors style runs pick from: speaker and body, then one per --speaker.
+#define MAX_STYLE_RUNS 4
+#define MAX_SPEAKER_NAME 32
+
+float RATE = RATE_SETTLED;  // Whole-screen jitter (e key); new entries jitter on their own.
 float RATE_RESET = 20;
+int target_fps = TARGET_FPS;
+Uint64 clock_last = 0;  // Counter at the last clock_tick; 0 after an idle wait.
+double clock_now = 0;  // Animation time in seconds; stands still while idle.
+Uint64 frame_deadline = 0;  // When the frame being drawn should be presented by.
+double transitions_end = 0;  // clock_now when the newest entry has settled.
 
 // Globals for window size.
 int screen_width = WW;
+SDL_atomic_t wrap_width = {MAX_WRAP_WIDTH};  // Set by the main loop on resize, read by the ingest thread.
+SDL_atomic_t wrap_serial;  // Bumped after every change to wrap_width or the glyph set.
 int screen_height = WH;
 
 typedef struct {
     uint8_t r, g, b, a;
 } Color;
 
-Color c1 = {0x55, 0x99, 0xFF, 0xFF};
-Color c2 = {0x77, 0x77, 0x77, 0xFF};
+enum { PALETTE_SPEAKER, PALETTE_BODY };  // Default slots, changed with F1-F4.
+
+Color palette[PALETTE_SIZE] = {
+    {0x55, 0x99, 0xFF, 0xFF},
+    {0x77, 0x77, 0x77, 0xFF},
+};
+int palette_size = 2;
+
+// A speaker with its own color (--speaker NAME=RRGGBB). Fixed before the ingest thread starts.
+typedef struct {
+    char name[MAX_SPEAKER_NAME];
+    uint8_t color;  // Palette slot.
+} Speaker;
+
+Speaker speakers[PALETTE_SIZE - 2];
+int num_speakers = 0;
+
+// Bytes of original_line up to end (exclusive) are drawn in palette[color].
+typedef struct {
+    uint16_t end;
+    uint8_t color;
+} StyleRun;
 
 typedef struct {
     int x, y;
@@ -55,36 +138,288 @@ typedef struct {
     int num_pixels;
     Pixel* pixels;
     int advance;
+    SDL_Rect atlas;  // Source rect in glyph_atlas.
 } GMap;
 
+// Jittered points queued for one draw call, all sharing one color and alpha.
+typedef struct {
+    SDL_Point* points;
+    int count;
+} PointBatch;
+
+// One wrapped line, as a slice of ChatEntry.original_line (at most LINE_BUFFER bytes).
+typedef struct {
+    uint16_t offset;
+    uint16_t length;
+} LineSpan;
+
+// Entries live in chunks carved out by one producer thread and released from any thread.
+// A chunk is recycled once its last entry is released.
+typedef struct ArenaChunk {
+    struct ArenaChunk* prev;  // All chunks, for freeing the whole arena in one pass.
+    struct ArenaChunk* next;
+    struct ArenaChunk* next_free;
+    SDL_atomic_t live;        // Allocations still in use, +1 while a producer is carving it.
+    size_t used;
+} ArenaChunk;
+
+#define ARENA_HEADER ((sizeof(ArenaChunk) + 15) & ~(size_t)15)
+
+// Frame stages timed by the profiler, in loop order.
+enum { STAGE_INGEST, STAGE_WRAP, STAGE_LAYOUT, STAGE_DRAW, STAGE_PRESENT, PROFILE_STAGES };
+const char* stage_names[PROFILE_STAGES] = {"ingest", "wrap", "layout", "draw", "present"};
+
+// One drawn frame. Times are in microseconds.
 typedef struct {
-    char* original_line;
-    char** wrapped_lines;
+    uint32_t frame;
+    float stage_us[PROFILE_STAGES];
+    uint32_t points;
+    uint32_t glyphs;
+    uint32_t cached;  // Entries from the line cache.
+} FrameSample;
+
+bool profiling = false;  // Off: one branch per stage and nothing else.
+bool profile_hud = false;
+FILE* profile_csv = NULL;  // --profile-csv: every sample, as it is taken.
+FrameSample profile_ring[PROFILE_SAMPLES];
+uint32_t profile_frames = 0;  // Samples taken; the newest is at (profile_frames - 1) % PROFILE_SAMPLES.
+uint32_t profile_hud_from = 0;  // profile_frames when the HUD was turned on; it shows only samples since.
+FrameSample profile_current;
+Uint64 profile_last = 0;  // Counter at the end of the previous stage.
+uint64_t profile_points, profile_glyphs, profile_cached;  // Counters when the frame began.
+
+bool latency_mode = false;  // --latency; fixed before the ingest thread starts.
+int64_t latency_start_ns = 0;  // When tc started: older tags are from an earlier loadgen run, read back from the log.
+int64_t* latency_drawn = NULL;  // Append times of tagged entries drawn this frame.
+int latency_drawn_count = 0, latency_drawn_cap = 0;
+uint32_t* latency_us = NULL;  // Append to present, per tagged line presented.
+int latency_count = 0, latency_cap = 0;
+int latency_tagged = 0;  // Tagged lines linked, shown or not.
+
+// Laid out as [ChatEntry][LineSpan x num_wrapped][original_line] in one arena allocation.
+typedef struct ChatEntry {
+    const char* original_line;
+    LineSpan* wrapped;
     int num_wrapped;
     int rendered_height;
+    uint32_t hash;    // Of original_line, for reuse across reloads.
+    bool unwrapped;   // Reload placeholder: takes over the old entry with the same text.
+    int wrap_serial;  // wrap_serial it was wrapped under, rewrapped once that changes.
+    bool freed;       // Set by free_chat_entry, for rewrap jobs that still pin its chunk.
+    double born;      // clock_now when it was first linked; its transition runs from there.
+    StyleRun runs[MAX_STYLE_RUNS];  // Colors, found once at ingest; the last run ends at UINT16_MAX.
+    int64_t tag_ns;   // --latency: when loadgen appended it (CLOCK_MONOTONIC), until first presented.
+    off_t offset;     // Where its text starts in the log; -1 if merged from several logs or not from one.
+    ArenaChunk* chunk;        // Holds the entry itself.
+    ArenaChunk* spans_chunk;  // Holds wrapped when it was filled in later, else NULL.
+
+    // Settled rendering of all wrapped lines, owned by the line cache.
+    SDL_Texture* texture;
+    size_t texture_bytes;
+    struct ChatEntry* cache_prev;  // LRU links, most recent at line_cache_head.
+    struct ChatEntry* cache_next;
 } ChatEntry;
 
+// ASCII glyphs rasterized at one point size. Sets are kept once built, so zooming back is instant.
+typedef struct GlyphSet {
+    int size;
+    int line_height;
+    GMap glyphs[128];
+    int advance_table[128];  // get_advance() for ASCII; [' '] is the space advance.
+    int loaded;              // Glyphs with pixels.
+    int max_height;
+    void* cache_map;         // When set, glyphs[].pixels point into this mapping instead of the heap.
+    size_t cache_len;
+    SDL_Texture* atlas;      // Made by the main loop when the set goes live.
+    bool atlas_failed;
+    SDL_Thread* builder;
+    SDL_atomic_t built;      // builder is done; status says how it went.
+    int status;
+    struct GlyphSet* next;
+} GlyphSet;
+
 // Globals.
 SDL_Window* w = NULL;
 SDL_Renderer* r = NULL;
-TTF_Font* font = NULL;
-GMap glyphs[128];
-int loaded_glyphs = 0;
+TTF_Font* font = NULL;  // Only for non-ASCII glyphs, at the live size.
+GlyphSet* glyph_sets = NULL;  // Every size built so far.
+GlyphSet* glyph_set = NULL;   // Live set; the globals below point into it.
+GlyphSet* glyph_set_building = NULL;
+int zoom_size = 0;        // Size the +/- keys asked for.
+int base_font_size = 0;   // Startup size, where LINE_HEIGHT and SPACE_ADVANCE apply unscaled.
+GMap* glyphs = NULL;
+int* advance_table = NULL;  // Swapped atomically: wrap_text runs on other threads.
+SDL_Texture* glyph_atlas = NULL;
+PointBatch point_batches[PALETTE_SIZE][256];  // [palette slot][alpha]
+uint64_t points_drawn = 0;  // By flush_point_batch, for --bench and the profiler.
+uint64_t glyphs_drawn = 0;  // Glyphs drawn one by one (atlas or points), not from the line cache.
+uint64_t cached_entries_drawn = 0;  // Entries copied whole from the line cache.
+uint32_t jitter_state[4];  // Four xorshift32 streams, one per SSE2 lane.
+int16_t jitter_offsets[2 * JITTER_BATCH];  // x, y pairs for render_gmap.
+int jitter_next = JITTER_BATCH;  // Pairs used; jitter_fill is due at JITTER_BATCH.
+int jitter_range = 0;  // (int)rate the batch was scaled for.
+int glyph_max_height = 0;
+int line_height = LINE_HEIGHT;
+SDL_mutex* font_lock = NULL;  // Every TTF call, and the non-ASCII glyph cache.
+char* loaded_font_path = NULL;  // Kept for rasterizing other sizes and non-ASCII glyphs.
+int loaded_font_size = 0;
 bool params = false;
 
-// Chat log globals.
+// Chat log globals (main loop).
+// chat_log is a ring of max_entries slots; logical entry i is chat_at(i).
 ChatEntry** chat_log = NULL;
+int chat_log_head = 0;
 int chat_log_size = 0;
-int chat_log_capacity = 0;
-FILE* log_file = NULL;
-off_t last_file_pos = 0;
-time_t last_mod_time = 0;
+int max_entries = MAX_ENTRIES;  // Fixed after startup; the ingest thread reads it too.
+
+// Entry heights by ring slot as a Fenwick tree, so the height above any entry is O(log n).
+int* height_tree = NULL;   // 1-based, max_entries + 1 cells. Empty slots count as 0.
+int height_tree_step = 1;  // Highest power of two <= max_entries.
+int chat_log_height = 0;   // Sum of every rendered_height in chat_log.
+int chat_log_evicted = 0;  // Height dropped off the top since the main loop last scrolled.
+bool rewrap_needed = false;  // Some entry is wrapped under an old wrap_serial.
+
+// Arena globals.
+SDL_mutex* arena_lock = NULL;  // Guards the lists below; taken once per chunk, not per entry.
+ArenaChunk* arena_chunks = NULL;
+ArenaChunk* arena_free_list = NULL;
+int arena_spare = 0;
+ArenaChunk* main_arena = NULL;    // Main loop's current chunk.
+ArenaChunk* ingest_arena = NULL;  // Ingest thread's current chunk.
+
+// One tailed log. Owned by the ingest thread once it starts.
+typedef struct {
+    const char* path;
+    const char* name;       // Basename, matched against directory events.
+    FILE* file;
+    off_t pos;              // Everything before this has been read.
+    time_t mod_time;
+    char tail_check[TAIL_CHECK_LEN];
+    int tail_check_len;
+    int file_wd;            // Watch on the log itself.
+    int dir_wd;             // Watch on its directory, to see a replacement appear.
+    bool changed, reopen;   // From this round's inotify events.
+    uint8_t color;          // Palette slot for its speakers.
+    char stamp[MAX_STAMP];  // Last leading timestamp read, for lines without one.
+} LogSource;
+
+LogSource* sources = NULL;
+int num_sources = 0;
+bool merge_by_time = false;  // --merge time; otherwise lines from different logs go in as they arrive.
+
+const Color source_colors[SOURCE_COLORS] = {
+    {0xFF, 0x99, 0x55, 0xFF}, {0x66, 0xCC, 0x66, 0xFF}, {0xCC, 0x77, 0xDD, 0xFF},
+    {0xEE, 0xCC, 0x44, 0xFF}, {0x44, 0xCC, 0xCC, 0xFF}, {0xFF, 0x66, 0x88, 0xFF},
+};
+
+// Lines from several logs waiting to be put in order, text packed in one buffer (ingest thread).
+typedef struct {
+    size_t text;            // Offset into merge.text.
+    uint32_t seq;           // Read order, to keep the sort stable.
+    uint8_t color;
+    char stamp[MAX_STAMP];
+} MergeLine;
+
+struct {
+    MergeLine* lines;
+    int count, cap;
+    char* text;
+    size_t text_len, text_cap;
+} merge;
+bool merge_loading = false;  // Tails are being read: hold every line, even by arrival.
+
+typedef enum {
+    INGEST_ENTRY,
+    INGEST_RELOAD_BEGIN,  // Log was truncated or replaced: the entries that follow rebuild chat_log.
+    INGEST_RELOAD_END,
+    INGEST_PAGE_BEGIN,  // Older lines asked for by history_request: offset is where they start,
+    INGEST_PAGE_LINE,   // then one entry per line, unwrapped,
+    INGEST_PAGE_END,    // and offset is where they end.
+} IngestKind;
+
+typedef struct {
+    IngestKind kind;
+    ChatEntry* entry;
+    off_t offset;
+} IngestItem;
 
-void render_gmap(SDL_Renderer* r, int ch, int x, int y, bool colon_flag);
+// Ingest globals. The ingest thread reads, splits and wraps lines and hands finished entries
+// to the main loop through a lock-free single-producer/single-consumer ring.
+typedef struct {
+    IngestItem ring[INGEST_RING_SIZE];
+    SDL_atomic_t head;          // Next item to pop; written only by the main loop.
+    SDL_atomic_t tail;          // Next free slot; written only by the ingest thread.
+    SDL_atomic_t wake_pending;  // An SDL event is already on its way to the main loop.
+    SDL_atomic_t quit;
+    Uint32 event_type;
+    SDL_Thread* thread;
+    int wake_pipe[2];           // Written to stop the thread.
+
+    int inotify_fd;             // -1 when falling back to stat() polling.
+
+    uint32_t* delivered;        // Hashes of the last max_entries lines sent, which the main loop may still hold.
+    int delivered_next;
+    int delivered_count;
+    uint32_t* reuse_set;        // During a reload: those hashes, open addressed, 0 = empty.
+    uint32_t reuse_mask;
+
+    SDL_SpinLock page_lock;     // Guards the page request below, set by the main loop.
+    bool page_wanted;
+    bool page_before;           // The lines before page_offset, else the lines from it on.
+    off_t page_offset;
+} Ingest;
+
+Ingest ingest = {.wake_pipe = {-1, -1}, .inotify_fd = -1};
+
+// Entries from before a reload, keyed by content, so unchanged lines skip wrap_text.
+typedef struct {
+    ChatEntry* entry;
+    bool taken;
+} ReusableEntry;
+
+ReusableEntry* reload_pool = NULL;
+uint32_t reload_pool_mask = 0;
+
+// History globals (main loop). Entries older than chat_log, paged back in from the log as the view
+// scrolls above it: one contiguous run of the file, [start, end). Attached when it runs right up to
+// chat_log, which then hands it the entries it evicts instead of freeing them.
+struct {
+    ChatEntry** entries;
+    int count, cap;
+    off_t start;
+    off_t end;         // Only when not attached.
+    bool attached;
+    bool viewing;      // The view is in the history, top_y pixels into entry top.
+    int top;
+    int top_y;
+    bool pending;      // A page was asked for and has not arrived yet.
+    off_t asked;       // Last page asked for, not asked again until the history changes.
+    bool asked_before;
+    ChatEntry** incoming;  // Page being received.
+    int incoming_count, incoming_cap;
+    off_t incoming_start;
+    bool incoming_failed;
+} history = {.attached = true, .asked = -1};
+
+// Line cache globals.
+ChatEntry* line_cache_head = NULL;
+ChatEntry* line_cache_tail = NULL;
+size_t line_cache_bytes = 0;
+size_t line_cache_cap = (size_t)LINE_CACHE_MB << 20;
+SDL_BlendMode line_cache_blend;
+
+void render_gmap(SDL_Renderer* r, const GMap* g, int x, int y, int color, float rate, int fade);
+int unicode_advance(uint32_t codepoint);
+const GMap* unicode_glyph(uint32_t codepoint);
+void flush_point_batches(SDL_Renderer* r);
+void tint_glyph_atlas(int color);
+void render_glyph_static(SDL_Renderer* r, int ch, int x, int y);
+void line_cache_drop(ChatEntry* entry);
 
 int get_advance(int ch_code) {
+    if (ch_code >= 128) return unicode_advance((uint32_t)ch_code);
     if (ch_code == 32) {  // Space.
-        return SPACE_ADVANCE;
+        return advance_table[' '];
     }
     if (ch_code >= 32 && ch_code < 127 && glyphs[ch_code].advance > 0) {
         return glyphs[ch_code].advance;
@@ -92,502 +427,3025 @@ int get_advance(int ch_code) {
     return 20;  // Fallback.
 }
 
-void wrap_text(const char* text, int max_width_pixels, char*** wrapped_lines_out, int* num_wrapped_out) {
-    *wrapped_lines_out = NULL;
-    *num_wrapped_out = 0;
-
-    if (!text || strlen(text) == 0) return;
-
-    // Split into words
-    size_t text_len = strlen(text);
-    char* line_copy = (char*)malloc(text_len + 1);  // Modifiable copy.
-    if (!line_copy) return;
-    strcpy(line_copy, text);
-    char* word = strtok(line_copy, " \t\n");
-    if (!word) {
-        free(line_copy);
-        return;
-    }
-
-    char* current_line = (char*)malloc(1024);  // Temp buffer
-    if (!current_line) {
-        free(line_copy);
-        return;
-    }
-    memset(current_line, 0, 1024);
-    int current_line_len = 0;
+// Previous wrapper (strspn/strcspn plus get_advance per char), kept as the baseline for --bench-wrap.
+int wrap_text_reference(const char* text, int max_width_pixels, LineSpan* spans, int max_spans) {
+    const char* seps = " \t\n";
+    int num_wrapped = 0;
+    int line_start = -1;  // Current line as offsets into text.
+    int line_end = 0;
     int current_advance = 0;
 
-    do {
-        int word_len = strlen(word);
+    int pos = (int)strspn(text, seps);
+    while (text[pos] != '\0') {
+        int word_len = (int)strcspn(text + pos, seps);
         int word_advance = 0;
         for (int i = 0; i < word_len; i++) {
-            int ch_code = (int)word[i];
+            int ch_code = (int)text[pos + i];
             word_advance += get_advance(ch_code);
         }
 
-        // Check if adding word exceeds width.
-        int space_advance = (current_line_len > 0) ? SPACE_ADVANCE : 0;
-        if (current_advance + space_advance + word_advance > max_width_pixels && current_line_len > 0) {
+        // Check if adding word exceeds width. Each whitespace char is drawn as a space.
+        int space_advance = (line_start >= 0) ? (pos - line_end) * SPACE_ADVANCE : 0;
+        if (current_advance + space_advance + word_advance > max_width_pixels && line_start >= 0) {
             // Push current line.
-            current_line[current_line_len] = '\0';
-            *wrapped_lines_out = (char**)realloc(*wrapped_lines_out, (*num_wrapped_out + 1) * sizeof(char*));
-            if (*wrapped_lines_out) {
-                char* new_line = (char*)calloc(1, current_line_len + 1);
-                if (new_line) {
-                    strcpy(new_line, current_line);
-                    (*wrapped_lines_out)[*num_wrapped_out] = new_line;
-                }
-                (*num_wrapped_out)++;
+            if (num_wrapped < max_spans) {
+                spans[num_wrapped].offset = (uint16_t)line_start;
+                spans[num_wrapped].length = (uint16_t)(line_end - line_start);
             }
-
-            // Reset for new line
-            memset(current_line, 0, 1024);
-            strcpy(current_line, word);
-            current_line_len = word_len;
+            num_wrapped++;
+            line_start = pos;
             current_advance = word_advance;
         } else {
             // Append to current
-            if (current_line_len > 0) {
-                current_line[current_line_len] = ' ';
-                current_line_len++;
-                current_advance += SPACE_ADVANCE;  // Use fixed space advance.
-            }
-            strcat(current_line, word);
-            current_line_len += word_len;
-            current_advance += word_advance;
+            if (line_start < 0) line_start = pos;
+            current_advance += space_advance + word_advance;
         }
-    } while ((word = strtok(NULL, " \t\n")) != NULL);
+        line_end = pos + word_len;
+        pos = line_end + (int)strspn(text + line_end, seps);
+    }
 
     // Push final line
-    if (current_line_len > 0) {
-        current_line[current_line_len] = '\0';
-        *wrapped_lines_out = (char**)realloc(*wrapped_lines_out, (*num_wrapped_out + 1) * sizeof(char*));
-        if (*wrapped_lines_out) {
-            char* new_line = (char*)calloc(1, current_line_len + 1);  // Zeroed alloc.
-            if (new_line) {
-                strcpy(new_line, current_line);
-                (*wrapped_lines_out)[*num_wrapped_out] = new_line;
-            }
-            (*num_wrapped_out)++;
+    if (line_start >= 0) {
+        if (num_wrapped < max_spans) {
+            spans[num_wrapped].offset = (uint16_t)line_start;
+            spans[num_wrapped].length = (uint16_t)(line_end - line_start);
         }
+        num_wrapped++;
     }
-
-    free(current_line);
-    free(line_copy);
+    return num_wrapped;
 }
 
-void add_chat_entry(const char* line) {
-    if (!line || strlen(line) == 0) return;
-
-    ChatEntry* entry = (ChatEntry*)calloc(1, sizeof(ChatEntry));
-    if (!entry) return;
-
-    size_t line_len = strlen(line);
-    entry->original_line = (char*)malloc(line_len + 1);
-    if (!entry->original_line) {
-        free(entry);
-        return;
+// Decode the UTF-8 sequence at s[*pos] without reading from end on, and step *pos past it.
+// A malformed or truncated sequence yields U+FFFD for its first byte only.
+uint32_t utf8_decode(const unsigned char* s, int* pos, int end) {
+    static const uint32_t min_codepoint[5] = {0, 0, 0x80, 0x800, 0x10000};
+    int i = *pos;
+    uint32_t c = s[i];
+    int len = (c >= 0xC2 && c < 0xE0) ? 2 : (c >= 0xE0 && c < 0xF0) ? 3 : (c >= 0xF0 && c < 0xF5) ? 4 : 0;
+    *pos = i + 1;
+    if (len == 0 || i + len > end) return 0xFFFD;
+    uint32_t codepoint = c & (0x7F >> len);
+    for (int k = 1; k < len; k++) {
+        if ((s[i + k] & 0xC0) != 0x80) return 0xFFFD;
+        codepoint = (codepoint << 6) | (s[i + k] & 0x3F);
     }
-    strcpy(entry->original_line, line);
-
-    wrap_text(line, MAX_WRAP_WIDTH, &entry->wrapped_lines, &entry->num_wrapped);
-    entry->rendered_height = entry->num_wrapped * LINE_HEIGHT;
+    if (codepoint < min_codepoint[len] || (codepoint >= 0xD800 && codepoint < 0xE000) || codepoint > 0x10FFFF) return 0xFFFD;
+    *pos = i + len;
+    return codepoint;
+}
 
-    if (chat_log_size >= chat_log_capacity) {
-        chat_log_capacity = chat_log_capacity == 0 ? 10 : chat_log_capacity * 2;
-        chat_log = (ChatEntry**)realloc(chat_log, chat_log_capacity * sizeof(ChatEntry*));
-        if (!chat_log) {
-            // Cleanup partial
-            free(entry->original_line);
-            free(entry);
-            return;
-        }
+// Index of the first space, tab, newline or terminator at or after pos.
+int find_word_end(const unsigned char* s, int pos) {
+    // Most words are short: check the first bytes one at a time before going wide.
+    for (int limit = pos + 16; pos < limit; pos++) {
+        if (s[pos] == '\0' || s[pos] == ' ' || s[pos] == '\t' || s[pos] == '\n') return pos;
     }
-    chat_log[chat_log_size] = entry;
-    chat_log_size++;
-
-    // Evict oldest if over limit
-    if (chat_log_size > MAX_ENTRIES) {
-        ChatEntry* old = chat_log[0];
-        for (int i = 0; i < old->num_wrapped; i++) {
-            free(old->wrapped_lines[i]);
-        }
-        free(old->wrapped_lines);
-        free(old->original_line);
-        free(old);
-        // Shift array
-        for (int i = 0; i < chat_log_size - 1; i++) {
-            chat_log[i] = chat_log[i + 1];
-        }
-        chat_log_size--;
+#ifdef __SSE2__
+    // Aligned 16-byte loads never cross into the next page, so reading past the terminator is safe.
+    const unsigned char* block = (const unsigned char*)((uintptr_t)(s + pos) & ~(uintptr_t)15);
+    unsigned mask = 0xFFFFu << (s + pos - block);
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i newline = _mm_set1_epi8('\n');
+    const __m128i zero = _mm_setzero_si128();
+    for (;;) {
+        __m128i v = _mm_load_si128((const __m128i*)block);
+        __m128i hit = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, space), _mm_cmpeq_epi8(v, tab)),
+                                   _mm_or_si128(_mm_cmpeq_epi8(v, newline), _mm_cmpeq_epi8(v, zero)));
+        unsigned bits = (unsigned)_mm_movemask_epi8(hit) & mask;
+        if (bits) return (int)(block - s) + __builtin_ctz(bits);
+        block += 16;
+        mask = 0xFFFFu;
     }
-
-    if (DEBUG) printf("Added entry %d: '%s' (wrapped to %d lines)\n", chat_log_size, line, entry->num_wrapped);
+#else
+    while (s[pos] && s[pos] != ' ' && s[pos] != '\t' && s[pos] != '\n') pos++;
+    return pos;
+#endif
 }
 
-int render_chat_entry(SDL_Renderer* r, ChatEntry* entry, int x_start, int y_start) {
-    int current_y = y_start;
-    for (int line_idx = 0; line_idx < entry->num_wrapped; line_idx++) {
-        const char* line_text = entry->wrapped_lines[line_idx];
-        if (!line_text) continue;  // Safety.
-        int current_x = x_start;
+// Break text at whitespace into lines no wider than max_width_pixels, in one pass and without allocating.
+// Each whitespace char measures as a space; a word wider than a whole line is broken between chars.
+// Fills at most max_spans spans and returns how many lines there are.
+int wrap_text(const char* text, int max_width_pixels, LineSpan* spans, int max_spans) {
+    const unsigned char* s = (const unsigned char*)text;
+    const int* advances = (const int*)SDL_AtomicGetPtr((void**)&advance_table);
+    int num_wrapped = 0;
+    int line_start = -1;  // Current line as offsets into text.
+    int line_end = 0;
+    int current_advance = 0;
+    int pos = 0;
+
+#define PUSH_LINE(start, end) do { \
+        if (num_wrapped < max_spans) { \
+            spans[num_wrapped].offset = (uint16_t)(start); \
+            spans[num_wrapped].length = (uint16_t)((end) - (start)); \
+        } \
+        num_wrapped++; \
+    } while (0)
+
+    for (;;) {
+        int gap = 0;
+        while (s[pos] == ' ' || s[pos] == '\t' || s[pos] == '\n') {
+            pos++;
+            gap++;
+        }
+        if (s[pos] == '\0') break;
 
-        bool colon_flag = false;
-        // Render each char in the wrapped line
-        size_t text_len = strlen(line_text);
-        for (size_t i = 0; i < text_len; i++) {
-            int c = (int)line_text[i];
-            if (c >= 32 && c < 127) {
-                if (c == 32) { //Space
-                    current_x += SPACE_ADVANCE;
-                } else if (glyphs[c].num_pixels > 0) {
-                    render_gmap(r, c, current_x, current_y, colon_flag);
-                   //current_x += glyphs[c].advance;
-                    // Advance x basic kerning approx
-                    current_x += glyphs[c].width + (glyphs[c].advance - glyphs[c].width) / 2;
-                } else {
-                    current_x += get_advance(c);  // Fallback advance without rendering.
+        int word_start = pos;
+        int word_end = find_word_end(s, pos);
+        int word_advance = 0;
+        while (pos < word_end) {
+            if (s[pos] < 0x80) word_advance += advances[s[pos++]];
+            else word_advance += unicode_advance(utf8_decode(s, &pos, word_end));
+        }
+
+        int space_advance = (line_start >= 0) ? gap * advances[' '] : 0;
+        if (line_start >= 0 && current_advance + space_advance + word_advance <= max_width_pixels) {
+            current_advance += space_advance + word_advance;
+        } else {
+            if (line_start >= 0) PUSH_LINE(line_start, line_end);
+            line_start = word_start;
+            current_advance = word_advance;
+            if (word_advance > max_width_pixels) {
+                // Too wide for any line: split it between codepoints, at least one per line.
+                current_advance = 0;
+                for (int i = word_start; i < word_end;) {
+                    int next = i;
+                    int advance = (s[i] < 0x80) ? advances[s[next++]] : unicode_advance(utf8_decode(s, &next, word_end));
+                    if (current_advance + advance > max_width_pixels && i > line_start) {
+                        PUSH_LINE(line_start, i);
+                        line_start = i;
+                        current_advance = 0;
+                    }
+                    current_advance += advance;
+                    i = next;
                 }
-                if(c == ':' || line_idx > 0 || c == ' ') colon_flag = true;
             }
         }
-
-        current_y += LINE_HEIGHT;
+        line_end = word_end;
     }
-    return current_y;
-}
 
-void poll_log_file(const char* filepath) {
-    struct stat file_stat;
-    if (stat(filepath, &file_stat) != 0) {
-        if (DEBUG) fprintf(stderr, "Stat failed for %s: %s\n", filepath, strerror(errno));
-        return;
-    }
+    if (line_start >= 0) PUSH_LINE(line_start, line_end);
+#undef PUSH_LINE
+    return num_wrapped;
+}
 
-    if (file_stat.st_mtime <= last_mod_time && file_stat.st_size <= last_file_pos) {
-        return;  // No change
+ArenaChunk* arena_new_chunk() {
+    ArenaChunk* chunk = NULL;
+    SDL_LockMutex(arena_lock);
+    if (arena_free_list) {
+        chunk = arena_free_list;
+        arena_free_list = chunk->next_free;
+        arena_spare--;
     }
-    else {
-        RATE = RATE_RESET;
+    SDL_UnlockMutex(arena_lock);
+
+    if (!chunk) {
+        chunk = (ArenaChunk*)malloc(ARENA_CHUNK_SIZE);
+        if (!chunk) return NULL;
+        SDL_LockMutex(arena_lock);
+        chunk->prev = NULL;
+        chunk->next = arena_chunks;
+        if (arena_chunks) arena_chunks->prev = chunk;
+        arena_chunks = chunk;
+        SDL_UnlockMutex(arena_lock);
     }
+    chunk->used = 0;
+    SDL_AtomicSet(&chunk->live, 1);  // The producer's reference.
+    return chunk;
+}
 
-    // File changed/grown: Open and read new lines
-    FILE* fp = fopen(filepath, "r");
-    if (!fp) {
-        if (DEBUG) fprintf(stderr, "Failed to open %s: %s\n", filepath, strerror(errno));
-        return;
+// Whoever drops the last reference recycles the chunk.
+void arena_release(ArenaChunk* chunk) {
+    if (SDL_AtomicAdd(&chunk->live, -1) != 1) return;
+    SDL_LockMutex(arena_lock);
+    if (arena_spare < ARENA_SPARE_CHUNKS) {
+        chunk->next_free = arena_free_list;
+        arena_free_list = chunk;
+        arena_spare++;
+    } else {
+        if (chunk->prev) chunk->prev->next = chunk->next;
+        else arena_chunks = chunk->next;
+        if (chunk->next) chunk->next->prev = chunk->prev;
+        free(chunk);
     }
+    SDL_UnlockMutex(arena_lock);
+}
 
-    char buffer[1024];
-    memset(buffer, 0, sizeof(buffer));
-    off_t read_pos = last_file_pos;
-    fseek(fp, read_pos, SEEK_SET);
-    while (fgets(buffer, sizeof(buffer), fp) != NULL) {
-        // Trim newline
-        size_t len = strlen(buffer);
-        if (len > 0 && buffer[len - 1] == '\n') buffer[len - 1] = '\0';
-        add_chat_entry(buffer);
+// Bump-allocate from a producer's current chunk; *owner gets the chunk to release it to.
+// Only one thread may allocate from a given current.
+void* arena_alloc(ArenaChunk** current, size_t size, ArenaChunk** owner) {
+    size = (size + 15) & ~(size_t)15;
+    if (size > ARENA_CHUNK_SIZE - ARENA_HEADER) return NULL;
+    if (!*current || (*current)->used + size > ARENA_CHUNK_SIZE - ARENA_HEADER) {
+        if (*current) arena_release(*current);
+        *current = arena_new_chunk();
+        if (!*current) return NULL;
+    }
+    void* p = (char*)*current + ARENA_HEADER + (*current)->used;
+    (*current)->used += size;
+    SDL_AtomicAdd(&(*current)->live, 1);
+    *owner = *current;
+    return p;
+}
 
-        // Re-zero
-        memset(buffer, 0, sizeof(buffer));
-        read_pos = ftell(fp);
+// Drops every chunk at once, whatever is still allocated in them. Producers must be stopped.
+void arena_free_all() {
+    while (arena_chunks) {
+        ArenaChunk* next = arena_chunks->next;
+        free(arena_chunks);
+        arena_chunks = next;
     }
+    arena_free_list = NULL;
+    arena_spare = 0;
+    main_arena = NULL;
+    ingest_arena = NULL;
+}
 
-    last_file_pos = ftell(fp);
-    last_mod_time = file_stat.st_mtime;
-    fclose(fp);
+uint32_t hash_line(const char* line) {
+    uint32_t h = 2166136261u;  // FNV-1a.
+    for (const unsigned char* p = (const unsigned char*)line; *p; p++) {
+        h = (h ^ *p) * 16777619u;
+    }
+    return h;
+}
 
-    if (DEBUG) printf("Polled %s: Added %ld new bytes (total entries: %d)\n", filepath, read_pos - last_file_pos, chat_log_size);
+// Ingest thread: color the first word, up to and including its ':' or space, as the speaker and
+// the rest as the body. Speakers given with --speaker get their own color, others speaker_color.
+void style_line(const char* line, StyleRun* runs, uint8_t speaker_color) {
+    size_t start = strspn(line, " \t");
+    size_t end = start;
+    while (line[end] && line[end] != ':' && line[end] != ' ' && line[end] != '\t') end++;
+    uint8_t color = speaker_color;
+    for (int i = 0; i < num_speakers; i++) {
+        if (strlen(speakers[i].name) == end - start && memcmp(speakers[i].name, line + start, end - start) == 0) {
+            color = speakers[i].color;
+            break;
+        }
+    }
+    if (line[end]) end++;
+    runs[0].end = (end < UINT16_MAX) ? (uint16_t)end : UINT16_MAX;
+    runs[0].color = color;
+    runs[1].end = UINT16_MAX;
+    runs[1].color = PALETTE_BODY;
 }
 
-int load_font(char *path, int size)
-{
-    font = TTF_OpenFont(path, size);
-    if (!font) {
-        fprintf(stderr, "Font load failed: %s (check path: '%s')\n", TTF_GetError(), path);
+// Parse NAME=RRGGBB into a speaker with its own palette slot.
+int add_speaker(const char* spec) {
+    const char* eq = strchr(spec, '=');
+    char* end = NULL;
+    unsigned long rgb = eq ? strtoul(eq + 1 + (eq[1] == '#'), &end, 16) : 0;
+    size_t name_len = eq ? (size_t)(eq - spec) : 0;
+    if (!eq || name_len == 0 || name_len >= MAX_SPEAKER_NAME || !end || *end || rgb > 0xFFFFFF) {
+        fprintf(stderr, "Bad --speaker '%s' (want NAME=RRGGBB)\n", spec);
         return 1;
     }
-    if(DEBUG) printf("Font loaded: %s, size %dpt (anti-aliased).\n", TTF_FontFaceFamilyName(font), size);
+    if (palette_size == PALETTE_SIZE) {
+        fprintf(stderr, "Too many speakers (at most %d)\n", PALETTE_SIZE - 2);
+        return 1;
+    }
+    Speaker* speaker = &speakers[num_speakers++];
+    memcpy(speaker->name, spec, name_len);
+    speaker->name[name_len] = '\0';
+    speaker->color = (uint8_t)palette_size;
+    palette[palette_size++] = (Color){(uint8_t)(rgb >> 16), (uint8_t)(rgb >> 8), (uint8_t)rgb, 0xFF};
+    return 0;
+}
 
-    // Pre-load glyphs into GMap array (ASCII 32-126)
-    SDL_Color fg_color = {255, 255, 255, 255};  // White foreground
-    loaded_glyphs = 0;
-    int empty_count = 0;
-    uint8_t threshold = 50;  // Extract pixels with a > threshold (AA edges)
+// Ingest thread: one arena allocation per line, spans and text included.
+ChatEntry* new_chat_entry(const char* line, bool wrap, uint8_t speaker_color) {
+    LineSpan spans[LINE_BUFFER];
+    int serial = SDL_AtomicGet(&wrap_serial);  // Before the width and advances it covers.
+    int width = SDL_AtomicGet(&wrap_width);
+    int num_wrapped = wrap ? wrap_text(line, width, spans, LINE_BUFFER) : 0;
+    if (num_wrapped > LINE_BUFFER) num_wrapped = LINE_BUFFER;
+    size_t line_len = strlen(line);
+    size_t spans_size = num_wrapped * sizeof(LineSpan);
+
+    ArenaChunk* chunk;
+    char* block = (char*)arena_alloc(&ingest_arena, sizeof(ChatEntry) + spans_size + line_len + 1, &chunk);
+    if (!block) return NULL;
+
+    ChatEntry* entry = (ChatEntry*)block;
+    memset(entry, 0, sizeof(ChatEntry));
+    entry->chunk = chunk;
+    entry->wrapped = (LineSpan*)(block + sizeof(ChatEntry));
+    memcpy(entry->wrapped, spans, spans_size);
+    entry->num_wrapped = num_wrapped;
+    char* text = block + sizeof(ChatEntry) + spans_size;
+    memcpy(text, line, line_len + 1);
+    entry->original_line = text;
+    entry->offset = -1;
+    entry->hash = hash_line(line);
+    style_line(text, entry->runs, speaker_color);
+    if (latency_mode && strncmp(text, LATENCY_TAG, strlen(LATENCY_TAG)) == 0) {
+        int64_t tag_ns = strtoll(text + strlen(LATENCY_TAG), NULL, 10);
+        if (tag_ns >= latency_start_ns) entry->tag_ns = tag_ns;
+    }
+    entry->unwrapped = !wrap;
+    entry->wrap_serial = wrap ? serial : -1;
+    return entry;
+}
 
-    for (int c = 32; c < 127; c++) {
-        // Render blended (AA)
-        SDL_Surface* surface = TTF_RenderGlyph_Blended(font, (Uint16)c, fg_color);
-        bool use_blended = true;
+// Main loop: wrap a reload placeholder whose old entry is gone, or rewrap under the current wrap_serial.
+// The new spans go in main_arena; the caller updates the height index.
+void wrap_chat_entry(ChatEntry* entry) {
+    LineSpan spans[LINE_BUFFER];
+    entry->wrap_serial = SDL_AtomicGet(&wrap_serial);
+    int num_wrapped = wrap_text(entry->original_line, SDL_AtomicGet(&wrap_width), spans, LINE_BUFFER);
+    if (num_wrapped > LINE_BUFFER) num_wrapped = LINE_BUFFER;
+    if (entry->spans_chunk) arena_release(entry->spans_chunk);
+    entry->wrapped = (LineSpan*)arena_alloc(&main_arena, num_wrapped * sizeof(LineSpan), &entry->spans_chunk);
+    if (entry->wrapped) memcpy(entry->wrapped, spans, num_wrapped * sizeof(LineSpan));
+    else num_wrapped = 0;
+    entry->num_wrapped = num_wrapped;
+    entry->rendered_height = num_wrapped * line_height;
+    entry->unwrapped = false;
+}
 
-        // Fallback to solid if empty
-        if (!surface || surface->w == 0 || surface->h == 0) {
-            if (surface) {
-                SDL_FreeSurface(surface);
-                if (DEBUG && empty_count < 5) printf("Blended empty for '%c' (trying solid)\n", c);
-            } else {
-                if (DEBUG && empty_count < 5) printf("Blended NULL for '%c': %s (trying solid)\n", c, TTF_GetError());
-            }
-            surface = TTF_RenderGlyph_Solid(font, (Uint16)c, fg_color);
-            use_blended = false;
-        }
+void free_chat_entry(ChatEntry* entry) {
+    line_cache_drop(entry);
+    entry->freed = true;
+    if (entry->spans_chunk) arena_release(entry->spans_chunk);
+    arena_release(entry->chunk);
+}
 
-        if (!surface || surface->w == 0 || surface->h == 0) {
-            int surf_w = surface ? surface->w : 0;
-            int surf_h = surface ? surface->h : 0;
-            if (surface) SDL_FreeSurface(surface);
-            empty_count++;
-            glyphs[c].width = 0;
-            glyphs[c].height = 0;
-            glyphs[c].num_pixels = 0;
-            glyphs[c].pixels = NULL;
-            glyphs[c].advance = 0;
-            if (DEBUG && (c == 'A' || empty_count < 3)) {
-                printf("Failed for '%c': w=%d h=%d, error: %s\n", c, surf_w, surf_h, TTF_GetError());
-            }
-            continue;
-        }
+ChatEntry* chat_at(int i) {
+    int slot = chat_log_head + i;
+    return chat_log[slot >= max_entries ? slot - max_entries : slot];
+}
 
-        // Extract visible pixels from surface
-        int width = surface->w;
-        int height = surface->h;
-        int visible_count = 0;
+void height_index_add(int slot, int delta) {
+    chat_log_height += delta;
+    for (int i = slot + 1; i <= max_entries; i += i & -i) height_tree[i] += delta;
+}
 
-        // First pass: Count visible pixels
-        SDL_PixelFormat* s_format = SDL_AllocFormat(surface->format->format);
-        if (!s_format) {
-            fprintf(stderr, "Format alloc failed for '%c'\n", c);
-            SDL_FreeSurface(surface);
-            continue;
-        }
-        uint8_t r_temp, g_temp, b_temp, a_temp;
-        for (int j = 0; j < height; ++j) {
-            Uint8* row = (Uint8*)surface->pixels + j * surface->pitch;
-            for (int i = 0; i < width; ++i) {
-                Uint32 pixel = *((Uint32*)(row + i * 4));  // Assume 4 bpp.
-                SDL_GetRGBA(pixel, s_format, &r_temp, &g_temp, &b_temp, &a_temp);
-                if (a_temp > threshold) visible_count++;
-            }
-        }
-        SDL_FreeFormat(s_format);
+// Sum of heights in slots [0, slot).
+int height_index_prefix(int slot) {
+    int sum = 0;
+    for (int i = slot; i > 0; i -= i & -i) sum += height_tree[i];
+    return sum;
+}
 
-        if (visible_count == 0) {
-            SDL_FreeSurface(surface);
-            empty_count++;
-            glyphs[c].width = width;
-            glyphs[c].height = height;
-            glyphs[c].num_pixels = 0;
-            glyphs[c].pixels = NULL;
-            glyphs[c].advance = 0;
-            continue;
+// Largest slot count whose prefix is <= target: the slot after it is the one covering target.
+int height_index_search(int target) {
+    int pos = 0;
+    for (int step = height_tree_step; step > 0; step >>= 1) {
+        if (pos + step <= max_entries && height_tree[pos + step] <= target) {
+            pos += step;
+            target -= height_tree[pos];
         }
+    }
+    return pos;
+}
 
-        // Second pass: Alloc and store visible pixels
-        glyphs[c].pixels = (Pixel*)calloc(visible_count, sizeof(Pixel));  // Zeroed alloc.
-        if (!glyphs[c].pixels) {
-            fprintf(stderr, "Memory alloc failed for '%c' pixels (%d)\n", c, visible_count);
-            SDL_FreeSurface(surface);
-            continue;
-        }
-        s_format = SDL_AllocFormat(surface->format->format);  // Re-alloc for extraction
-        int stored_count = 0;
-        for (int j = 0; j < height; ++j) {
-            Uint8* row = (Uint8*)surface->pixels + j * surface->pitch;
-            for (int i = 0; i < width; ++i) {
-                Uint32 pixel = *((Uint32*)(row + i * 4));
-                SDL_GetRGBA(pixel, s_format, &r_temp, &g_temp, &b_temp, &a_temp);
-                if (a_temp > threshold) {
-                    glyphs[c].pixels[stored_count].x = i;
-                    glyphs[c].pixels[stored_count].y = j;
-                    glyphs[c].pixels[stored_count].r = r_temp;
-                    glyphs[c].pixels[stored_count].g = g_temp;
-                    glyphs[c].pixels[stored_count].b = b_temp;
-                    glyphs[c].pixels[stored_count].a = a_temp;
-                    stored_count++;
-                }
-            }
-        }
-        SDL_FreeFormat(s_format);
-        SDL_FreeSurface(surface);
+// Height of the entries above logical entry i.
+int chat_height_before(int i) {
+    int slot = chat_log_head + i;
+    int before_head = height_index_prefix(chat_log_head);
+    if (slot <= max_entries) return height_index_prefix(slot) - before_head;
+    return chat_log_height - before_head + height_index_prefix(slot - max_entries);
+}
 
-        // Store metadata
-        glyphs[c].width = width;
-        glyphs[c].height = height;
-        glyphs[c].num_pixels = stored_count;
-        TTF_GlyphMetrics(font, (Uint16)c, NULL, NULL, NULL, &glyphs[c].advance, NULL);
-        loaded_glyphs++;
+// Logical index of the entry covering y, measured from the top of the log.
+int chat_index_at(int y) {
+    // Slots before the head hold zero height unless the ring has wrapped around to them.
+    int before_head = height_index_prefix(chat_log_head);
+    int tail_height = chat_log_height - before_head;
+    if (y < tail_height) return height_index_search(y + before_head) - chat_log_head;
+    return height_index_search(y - tail_height) + max_entries - chat_log_head;
+}
 
-        // Debug samples
-        if (c == 'H' || c == 'e' || c == 'l' || c == 'o' || c == ' ' || c == 'A') {
-            if(DEBUG) printf("Glyph '%c': w=%d, h=%d, visible_pixels=%d, advance=%d (%s)\n", 
-                             c, glyphs[c].width, glyphs[c].height, stored_count, glyphs[c].advance, use_blended ? "AA blended" : "solid");
+// On INGEST_RELOAD_BEGIN the current entries become a pool keyed by content.
+void reload_pool_fill() {
+    uint32_t slots = 1;
+    while (slots < (uint32_t)chat_log_size * 2) slots <<= 1;
+    reload_pool = (ReusableEntry*)calloc(slots, sizeof(ReusableEntry));
+    reload_pool_mask = slots - 1;
+    for (int i = 0; i < chat_log_size; i++) {
+        ChatEntry* entry = chat_at(i);
+        if (!reload_pool) {
+            free_chat_entry(entry);
+            continue;
         }
+        uint32_t j = entry->hash & reload_pool_mask;
+        while (reload_pool[j].entry) j = (j + 1) & reload_pool_mask;
+        reload_pool[j].entry = entry;
     }
+    chat_log_head = 0;
+    chat_log_size = 0;
+    memset(height_tree, 0, (max_entries + 1) * sizeof(int));
+    chat_log_height = 0;
+}
 
-    if(DEBUG) {
-        printf("Loaded %d glyphs into GMap array (%d empty). Sample 'A' (65): pixels=%d\n", 
-               loaded_glyphs, empty_count, glyphs[65].num_pixels);
-        if (empty_count > 90) printf("CRITICAL: Most glyphs empty—check font path.\n");
+// A placeholder with matching text takes over its old entry (wrapping, cached texture and all).
+ChatEntry* reload_pool_take(const ChatEntry* placeholder) {
+    if (!reload_pool) return NULL;
+    for (uint32_t i = placeholder->hash & reload_pool_mask; reload_pool[i].entry; i = (i + 1) & reload_pool_mask) {
+        if (!reload_pool[i].taken && strcmp(reload_pool[i].entry->original_line, placeholder->original_line) == 0) {
+            reload_pool[i].taken = true;
+            return reload_pool[i].entry;
+        }
     }
-
-
-    // Free
-    TTF_CloseFont(font);
-    font = NULL;
-
-    return 0;
+    return NULL;
 }
 
-void render_gmap(SDL_Renderer* r, int ch, int x, int y, bool colon_flag) {
-    if (ch < 0 || ch >= 128 || glyphs[ch].num_pixels == 0 || !glyphs[ch].pixels) {
-        if (DEBUG) printf("Skipping invalid glyph '%c' (code %d)\n", (char)ch, ch);
-        return;
+// On INGEST_RELOAD_END whatever was not taken over is gone from the file.
+void reload_pool_release() {
+    if (!reload_pool) return;
+    int reused = 0;
+    for (uint32_t i = 0; i <= reload_pool_mask; i++) {
+        if (!reload_pool[i].entry) continue;
+        if (reload_pool[i].taken) reused++;
+        else free_chat_entry(reload_pool[i].entry);
     }
+    free(reload_pool);
+    reload_pool = NULL;
+    if (DEBUG) printf("Reloaded log: %d entries (%d reused)\n", chat_log_size, reused);
+}
 
-    if(RATE > 1.1) RATE -= 0.01; 
-
-    int drawn_points = 0;
-    for (int i = 0; i < glyphs[ch].num_pixels; ++i) {
-        Pixel* p = &glyphs[ch].pixels[i];
-        // Set color with alpha (blends on black bg)
-        if(colon_flag == false) {
-            SDL_SetRenderDrawColor(r, c1.r, c1.g, c1.b, p->a);
-            //SDL_SetRenderDrawColor(r, 0x55, 0x99, 0xFF, 0xFF);
-        }
-        else {
-            //SDL_SetRenderDrawColor(r, p->r, p->g, p->b, p->a);
-            SDL_SetRenderDrawColor(r, c2.r, c2.g, c2.b, p->a);
-            //SDL_SetRenderDrawColor(r, 0x77, 0x77, 0x77, 0xFF);
-        }
-
-        //Rand Offset
-        int off_x = rand() % (int)RATE - (RATE/2);
-        int off_y = rand() % (int)RATE - (RATE/2);
+// Main loop: history entry i, wrapped at the current width first if it has not been yet.
+ChatEntry* history_at(int i) {
+    ChatEntry* entry = history.entries[i];
+    if (entry->wrap_serial != SDL_AtomicGet(&wrap_serial)) {
+        wrap_chat_entry(entry);
+        line_cache_drop(entry);
+    }
+    return entry;
+}
 
-        //Random Noise
-        //if(rand() % 100 == 1) SDL_SetRenderDrawColor(r, rand() % 255, rand() % 255, rand() % 255, p->a);
-        //Regular Noise
-        //if(i % 5 == 0) SDL_SetRenderDrawColor(r, 0x00, 0x00, 0x00, p->a);
+bool history_reserve(int count) {
+    if (count <= history.cap) return true;
+    int cap = history.cap ? history.cap : HISTORY_PAGE_LINES;
+    while (cap < count) cap *= 2;
+    ChatEntry** entries = (ChatEntry**)realloc(history.entries, cap * sizeof(ChatEntry*));
+    if (!entries) return false;
+    history.entries = entries;
+    history.cap = cap;
+    return true;
+}
 
+void history_clear() {
+    for (int i = 0; i < history.count; i++) free_chat_entry(history.entries[i]);
+    history.count = 0;
+    history.attached = true;
+    history.viewing = false;
+    history.asked = -1;
+}
 
-        if (SDL_RenderDrawPoint(r, x + p->x + off_x, y + p->y + off_y) == 0) {
-            drawn_points++;
+// Keep at most HISTORY_MAX_LINES, dropping a page at a time from the end further from the view.
+void history_trim() {
+    while (history.count > HISTORY_MAX_LINES) {
+        int n = HISTORY_PAGE_LINES;
+        if (history.viewing && history.top < history.count / 2) {
+            // The bottom goes: paged back in from the log when scrolled down to again.
+            history.end = history.entries[history.count - n]->offset;
+            history.attached = false;
+            for (int i = history.count - n; i < history.count; i++) free_chat_entry(history.entries[i]);
         } else {
-            if (DEBUG) fprintf(stderr, "DrawPoint failed for '%c' at (%d,%d): %s\n", (char)ch, x + p->x, y + p->y, SDL_GetError());
+            for (int i = 0; i < n; i++) free_chat_entry(history.entries[i]);
+            memmove(history.entries, history.entries + n, (history.count - n) * sizeof(ChatEntry*));
+            history.start = history.entries[0]->offset;
+            if (history.viewing) history.top -= n;
         }
+        history.count -= n;
+        history.asked = -1;
     }
+}
 
-    if (DEBUG) printf("Rendered glyph '%c': %d points drawn\n", (char)ch, drawn_points);
+// Main loop: take an entry chat_log evicted. Returns false if the history isn't attached (or can't
+// grow), and the entry should just be freed.
+bool history_append(ChatEntry* entry) {
+    if (history.count == 0 || !history.attached || !history_reserve(history.count + 1)) return false;
+    entry->tag_ns = 0;  // --latency counts lines as they first show up, not when scrolled back to.
+    history.entries[history.count++] = entry;
+    history_trim();
+    return true;
 }
 
-int get_total_chat_height() {
-    int total = 0;
-    for (int i = 0; i < chat_log_size; i++) {
-        if (chat_log[i]) {
-            total += chat_log[i]->rendered_height;
+// Main loop: ask the ingest thread for the page of lines before (or from) offset.
+void history_request(off_t offset, bool before) {
+    if (history.pending || (offset == history.asked && before == history.asked_before)) return;
+    SDL_AtomicLock(&ingest.page_lock);
+    ingest.page_wanted = true;
+    ingest.page_before = before;
+    ingest.page_offset = offset;
+    SDL_AtomicUnlock(&ingest.page_lock);
+    if (write(ingest.wake_pipe[1], "p", 1) != 1) {
+        if (DEBUG) fprintf(stderr, "Page request failed: %s\n", strerror(errno));
+        return;
+    }
+    history.pending = true;
+    history.asked = offset;
+    history.asked_before = before;
+}
+
+void history_page_line(ChatEntry* entry) {
+    if (history.incoming_count == history.incoming_cap) {
+        int cap = history.incoming_cap ? history.incoming_cap * 2 : HISTORY_PAGE_LINES;
+        ChatEntry** incoming = (ChatEntry**)realloc(history.incoming, cap * sizeof(ChatEntry*));
+        if (!incoming) {
+            history.incoming_failed = true;
+            free_chat_entry(entry);
+            return;
         }
+        history.incoming = incoming;
+        history.incoming_cap = cap;
     }
-    return total;
+    history.incoming[history.incoming_count++] = entry;
 }
 
-int main(int argc, char* argv[]) 
-{ 
-    if(argc >= 2) params = true;
-    char *font_path;
-    int font_size = 16;
-    if(params == false) font_path = "fonts/Hack-Regular.ttf";
-    else font_path = argv[1];
-    if(argc >= 3) font_size = atoi(argv[2]);
-    const char* log_filepath = (argc >= 4) ? argv[3] : "log.txt";
+// A page has arrived: it goes above the history, or below it up to where chat_log begins.
+// One that no longer lines up with either (chat_log moved on meanwhile) is dropped.
+void history_page_end(off_t end) {
+    ChatEntry** lines = history.incoming;
+    int n = history.incoming_count;
+    off_t boundary = chat_log_size > 0 ? chat_at(0)->offset : -1;
+    history.pending = false;
+    history.incoming_count = 0;
+    int used = 0;
+    bool moved = false;  // Otherwise the same page would just be asked for again.
+
+    bool above = history.count > 0 ? end == history.start : boundary >= 0 && end == boundary;
+    bool below = history.count > 0 && !history.attached && history.incoming_start == history.end;
+    if (history.incoming_failed || !history_reserve(history.count + n)) {
+        moved = true;  // Dropped; asked for again when the view gets there.
+    } else if (above) {
+        moved = n > 0 || (history.count > 0 && history.incoming_start < history.start);  // Or only blank lines.
+        memmove(history.entries + n, history.entries, history.count * sizeof(ChatEntry*));
+        memcpy(history.entries, lines, n * sizeof(ChatEntry*));
+        history.count += n;
+        history.start = history.incoming_start;
+        if (history.viewing) history.top += n;
+        used = n;
+    } else if (below) {
+        for (; used < n && (boundary < 0 || lines[used]->offset < boundary); used++) {
+            history.entries[history.count++] = lines[used];
+        }
+        moved = used > 0 || end > history.end;
+        history.end = end;
+        history.attached = used < n || (boundary >= 0 && end >= boundary);
+    }
+    for (int i = used; i < n; i++) free_chat_entry(lines[i]);
+    history.incoming_failed = false;
+    if (moved) history.asked = -1;
+    history_trim();
+}
 
-    if (SDL_Init(SDL_INIT_VIDEO) < 0) { fprintf(stderr, "SDL init failed: %s\n", SDL_GetError()); return 1; }
-    if (TTF_Init() < 0) { fprintf(stderr, "TTF init failed: %s\n", TTF_GetError()); SDL_Quit(); return 1; }
+// Main loop: move the view up into the history once it goes above chat_log, keep it on an entry
+// there, and hand it back to chat_log when it scrolls down past the history.
+void history_view(int* view_y_offset) {
+    if (!history.viewing) {
+        if (*view_y_offset >= 0) return;
+        if (history.count == 0 || !history.attached) {
+            *view_y_offset = 0;  // Nothing paged in yet; history_read_ahead asks for it.
+            return;
+        }
+        history.viewing = true;
+        history.top = history.count;
+        history.top_y = *view_y_offset;
+    }
+    *view_y_offset = 0;
 
-    w = SDL_CreateWindow("tc", WX, WY, WW, WH, SDL_WINDOW_BORDERLESS);
-    if (!w) {
-        fprintf(stderr, "Window creation failed: %s\n", SDL_GetError());
-        TTF_Quit();
-        SDL_Quit();
-        return 1;
+    while (history.top_y < 0 && history.top > 0) {
+        history.top--;
+        history.top_y += history_at(history.top)->rendered_height;
     }
-    r = SDL_CreateRenderer(w, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
-    if (!r) {
-        fprintf(stderr, "Renderer creation failed: %s\n", SDL_GetError());
-        SDL_DestroyWindow(w);
-        TTF_Quit();
-        SDL_Quit();
-        return 1;
+    if (history.top_y < 0) history.top_y = 0;  // Top of what is paged in.
+    while (history.top < history.count && history.top_y >= history_at(history.top)->rendered_height) {
+        history.top_y -= history_at(history.top)->rendered_height;
+        history.top++;
     }
-    SDL_SetRenderDrawBlendMode(r, SDL_BLENDMODE_BLEND);
+    if (history.top < history.count) return;
+    if (history.attached) {
+        history.viewing = false;
+        *view_y_offset = history.top_y;
+    } else {
+        history.top = history.count - 1;  // Bottom of what is paged in.
+        history.top_y = 0;
+    }
+}
 
-    if(load_font(font_path, font_size) != 0) {
-        SDL_DestroyRenderer(r);
-        SDL_DestroyWindow(w);
-        TTF_Quit();
-        SDL_Quit();
-        return 1;
+// Main loop: ask for the next page while the view is still HISTORY_READ_AHEAD entries (or a
+// screen, above chat_log) from the edge, so it is usually in before the view gets there.
+void history_read_ahead(int view_y_offset, bool paging_back) {
+    if (num_sources != 1 || chat_log_size == 0 || chat_at(0)->offset <= 0) return;
+    if (history.viewing) {
+        if (history.top < HISTORY_READ_AHEAD && history.start > 0) history_request(history.start, true);
+        else if (!history.attached && history.count - history.top < HISTORY_READ_AHEAD) history_request(history.end, false);
+    } else if (paging_back && view_y_offset < screen_height) {
+        if (history.count == 0) history_request(chat_at(0)->offset, true);
+        else if (history.start > 0 && history.count < HISTORY_READ_AHEAD) history_request(history.start, true);
     }
+}
 
-    // Force space advance if zero
-    if (glyphs[32].advance == 0) {
-        glyphs[32].advance = SPACE_ADVANCE;
-        if (DEBUG) printf("Forced space advance to %d (was 0)\n", SPACE_ADVANCE);
+// Main loop: link a finished entry into chat_log.
+void add_chat_entry(ChatEntry* entry) {
+    bool reused = false;
+    if (entry->unwrapped) {
+        ChatEntry* old = reload_pool_take(entry);
+        if (old) {
+            old->offset = entry->offset;
+            free_chat_entry(entry);
+            entry = old;
+            reused = true;  // Already on screen: no transition.
+        } else {
+            wrap_chat_entry(entry);  // Evicted since, or a hash collision.
+        }
+    }
+    if (!reused) {
+        if (entry->tag_ns) latency_tagged++;
+        entry->born = clock_now;
+        transitions_end = clock_now + (RATE_RESET - JITTER_VISIBLE) / RATE_DECAY;
     }
 
-    // Initialize log file polling.
-    log_file = fopen(log_filepath, "r");
-    if (log_file) {
-        fseek(log_file, 0, SEEK_END);
-        last_file_pos = ftell(log_file);
-        struct stat st;
-        stat(log_filepath, &st);
-        last_mod_time = st.st_mtime;
-        if (DEBUG) printf("Initialized log file '%s' at position %ld\n", log_filepath, last_file_pos);
-    } else {
-        fprintf(stderr, "Warning: Could not open log file '%s'—create it with chat lines.\n", log_filepath);
+    // Evict oldest if full: its slot becomes the new tail, and it moves to the history if that is paged in.
+    if (chat_log_size == max_entries) {
+        ChatEntry* oldest = chat_log[chat_log_head];
+        height_index_add(chat_log_head, -oldest->rendered_height);
+        chat_log_evicted += oldest->rendered_height;
+        if (!history_append(oldest)) free_chat_entry(oldest);
+        chat_log_head = (chat_log_head + 1) % max_entries;
+        chat_log_size--;
     }
+    int slot = (chat_log_head + chat_log_size) % max_entries;
+    chat_log[slot] = entry;
+    chat_log_size++;
+    entry->rendered_height = entry->num_wrapped * line_height;
+    height_index_add(slot, entry->rendered_height);
+    if (entry->wrap_serial != SDL_AtomicGet(&wrap_serial)) rewrap_needed = true;  // Wrapped before a resize or zoom.
 
+    if (DEBUG) printf("Added entry %d: '%s' (wrapped to %d lines)\n", chat_log_size, entry->original_line, entry->num_wrapped);
+}
 
+// Jitter of an entry: its own envelope since it arrived, or the whole-screen RATE if that is higher.
+float entry_rate(const ChatEntry* entry) {
+    float rate = RATE_RESET - RATE_DECAY * (float)(clock_now - entry->born);
+    return rate > RATE ? rate : RATE;
+}
 
-    int view_y_offset = 0;  // For scrolling
+// Opacity of an entry fading in, 0-256.
+int entry_fade(const ChatEntry* entry) {
+    double age = clock_now - entry->born;
+    return age >= FADE_IN_TIME ? 256 : (int)(256 * age / FADE_IN_TIME);
+}
 
-    // Initial load: Read existing lines
-    if (log_file) {
-        rewind(log_file);
-        char buffer[1024];
-        while (fgets(buffer, sizeof(buffer), log_file) != NULL) {
-            size_t len = strlen(buffer);
-            if (len > 0 && buffer[len - 1] == '\n') buffer[len - 1] = '\0';
-            add_chat_entry(buffer);
+// Draw (or with r == NULL just measure) the wrapped lines of entry at jitter rate. Returns the
+// widest line extent. Lines wholly outside [clip_top, clip_bottom) are skipped.
+int draw_entry_lines(SDL_Renderer* r, ChatEntry* entry, int x_start, int y_start, float rate, int clip_top, int clip_bottom) {
+    bool settled = glyph_atlas && rate < JITTER_VISIBLE;
+    int fade = (r && !settled) ? entry_fade(entry) : 256;
+    int max_x = x_start;
+    int current_y = y_start;
+    for (int line_idx = 0; line_idx < entry->num_wrapped; line_idx++) {
+        if (current_y + glyph_max_height <= clip_top || current_y >= clip_bottom) {
+            current_y += line_height;
+            continue;
         }
-        fseek(log_file, 0, SEEK_END);
-        last_file_pos = ftell(log_file);
-
+        int line_offset = entry->wrapped[line_idx].offset;
+        const unsigned char* line_text = (const unsigned char*)entry->original_line + line_offset;
+        int current_x = x_start;
 
-        // Initial auto-scroll to bottom
-        int total_height = get_total_chat_height();
-        int visible_height = screen_height - 2 * MARGIN_Y;
-        int max_offset = (total_height > visible_height) ? total_height - visible_height : 0;
-        view_y_offset = max_offset;
+        // Color comes from the run each char falls in; the atlas is tinted once per run.
+        const StyleRun* run = entry->runs;
+        while (line_offset >= run->end) run++;
+        int run_end = run->end - line_offset;
+        if (r && settled) tint_glyph_atlas(run->color);
 
+        // Render each char in the wrapped line
+        int text_len = entry->wrapped[line_idx].length;
+        for (int i = 0; i < text_len;) {
+            if (i >= run_end) {
+                run++;
+                run_end = run->end - line_offset;
+                if (r && settled) tint_glyph_atlas(run->color);
+            }
+            int c = line_text[i];
+            if (c >= 0x80) {
+                // Non-ASCII: points from the lazily filled glyph cache, settled or not.
+                const GMap* g = unicode_glyph(utf8_decode(line_text, &i, text_len));
+                if (g->num_pixels > 0) {
+                    if (current_x + g->width > max_x) max_x = current_x + g->width;
+                    if (r) {
+                        render_gmap(r, g, current_x, current_y, run->color, rate, fade);
+                        glyphs_drawn++;
+                    }
+                    current_x += g->width + (g->advance - g->width) / 2;
+                } else {
+                    current_x += g->advance;  // Fallback advance without rendering.
+                }
+                continue;
+            }
+            i++;
+            if (c == '\t') c = ' ';  // wrap_text measures tabs as spaces.
+            if (c >= 32 && c < 127) {
+                if (c == 32) { //Space
+                    current_x += advance_table[' '];
+                } else if (glyphs[c].num_pixels > 0) {
+                    if (current_x + glyphs[c].width > max_x) max_x = current_x + glyphs[c].width;
+                    if (!r) {
+                        // Measure only.
+                    } else if (settled) render_glyph_static(r, c, current_x, current_y);
+                    else render_gmap(r, &glyphs[c], current_x, current_y, run->color, rate, fade);
+                    if (r) glyphs_drawn++;
+                   //current_x += glyphs[c].advance;
+                    // Advance x basic kerning approx
+                    current_x += glyphs[c].width + (glyphs[c].advance - glyphs[c].width) / 2;
+                } else {
+                    current_x += get_advance(c);  // Fallback advance without rendering.
+                }
+            }
+        }
+
+        current_y += line_height;
+    }
+    return max_x - x_start;
+}
+
+// Most recently drawn entries live at the head; eviction takes from the tail.
+void line_cache_unlink(ChatEntry* entry) {
+    if (entry->cache_prev) entry->cache_prev->cache_next = entry->cache_next;
+    else line_cache_head = entry->cache_next;
+    if (entry->cache_next) entry->cache_next->cache_prev = entry->cache_prev;
+    else line_cache_tail = entry->cache_prev;
+    entry->cache_prev = entry->cache_next = NULL;
+}
+
+void line_cache_push_head(ChatEntry* entry) {
+    entry->cache_prev = NULL;
+    entry->cache_next = line_cache_head;
+    if (line_cache_head) line_cache_head->cache_prev = entry;
+    line_cache_head = entry;
+    if (!line_cache_tail) line_cache_tail = entry;
+}
+
+void line_cache_drop(ChatEntry* entry) {
+    if (!entry->texture) return;
+    line_cache_unlink(entry);
+    SDL_DestroyTexture(entry->texture);
+    entry->texture = NULL;
+    line_cache_bytes -= entry->texture_bytes;
+    entry->texture_bytes = 0;
+}
+
+// Called when the palette changes or the window is resized.
+void line_cache_clear() {
+    while (line_cache_head) line_cache_drop(line_cache_head);
+}
+
+// Cached textures are premultiplied (glyphs blended onto transparent black).
+// Renderers without custom blend modes (e.g. software) run uncached.
+void line_cache_init(SDL_Renderer* r) {
+    line_cache_blend = SDL_ComposeCustomBlendMode(SDL_BLENDFACTOR_ONE, SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA, SDL_BLENDOPERATION_ADD,
+                                                  SDL_BLENDFACTOR_ONE, SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA, SDL_BLENDOPERATION_ADD);
+    SDL_Texture* probe = SDL_RenderTargetSupported(r) ? SDL_CreateTexture(r, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, 1, 1) : NULL;
+    if (!probe || SDL_SetTextureBlendMode(probe, line_cache_blend) != 0) {
+        if (DEBUG) printf("Line cache disabled: %s\n", SDL_GetError());
+        line_cache_cap = 0;
+    }
+    if (probe) SDL_DestroyTexture(probe);
+}
+
+// --cache-mb: megabytes, 0 to turn the cache off.
+int set_line_cache_mb(const char* arg) {
+    char* end = NULL;
+    errno = 0;
+    long mb = strtol(arg, &end, 10);
+    if (errno || end == arg || *end || mb < 0 || (unsigned long)mb > SIZE_MAX >> 20) {
+        fprintf(stderr, "Bad --cache-mb '%s' (want megabytes, 0 or more)\n", arg);
+        return 1;
+    }
+    line_cache_cap = (size_t)mb << 20;
+    return 0;
+}
+
+// Composite a settled entry into its own texture. Leaves entry->texture NULL on failure.
+void line_cache_build(SDL_Renderer* r, ChatEntry* entry) {
+    int tex_w = draw_entry_lines(NULL, entry, 0, 0, RATE_SETTLED, INT_MIN, INT_MAX);
+    int tex_h = (entry->num_wrapped - 1) * line_height + glyph_max_height;
+    if (tex_w <= 0 || tex_h <= 0) return;
+
+    size_t bytes = (size_t)tex_w * tex_h * 4;
+    if (bytes > line_cache_cap) return;
+    while (line_cache_tail && line_cache_bytes + bytes > line_cache_cap) line_cache_drop(line_cache_tail);
+
+    SDL_Texture* texture = SDL_CreateTexture(r, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, tex_w, tex_h);
+    if (!texture) {
+        if (DEBUG) fprintf(stderr, "Line cache texture failed (%dx%d): %s\n", tex_w, tex_h, SDL_GetError());
+        return;
+    }
+    SDL_SetTextureBlendMode(texture, line_cache_blend);
+
+    // Non-ASCII glyphs go through point_batches: the screen's points are drawn before switching,
+    // and the entry's own before switching back.
+    SDL_Texture* target = SDL_GetRenderTarget(r);
+    flush_point_batches(r);
+    SDL_SetRenderTarget(r, texture);
+    SDL_SetRenderDrawColor(r, 0, 0, 0, 0);
+    SDL_RenderClear(r);
+    draw_entry_lines(r, entry, 0, 0, RATE_SETTLED, INT_MIN, INT_MAX);
+    flush_point_batches(r);
+    SDL_SetRenderTarget(r, target);
+
+    entry->texture = texture;
+    entry->texture_bytes = bytes;
+    line_cache_bytes += bytes;
+    line_cache_push_head(entry);
+}
+
+void latency_note_drawn(ChatEntry* entry);
+
+int render_chat_entry(SDL_Renderer* r, ChatEntry* entry, int x_start, int y_start, int clip_top, int clip_bottom) {
+    // On the frame it is linked an entry is at fade 0 and not visible yet.
+    if (entry->tag_ns && entry_fade(entry) > 0) latency_note_drawn(entry);
+
+    // Jitter has settled: copy glyphs straight from the atlas. Only new entries (or all of them
+    // after the e key) take the per-pixel path.
+    float rate = entry_rate(entry);
+    bool settled = glyph_atlas && rate < JITTER_VISIBLE;
+
+    if (settled && line_cache_cap > 0) {
+        if (!entry->texture) line_cache_build(r, entry);
+        if (entry->texture) {
+            int tex_w, tex_h;
+            SDL_QueryTexture(entry->texture, NULL, NULL, &tex_w, &tex_h);
+            SDL_Rect dst = {x_start, y_start, tex_w, tex_h};
+            SDL_RenderCopy(r, entry->texture, NULL, &dst);
+            cached_entries_drawn++;
+            if (entry != line_cache_head) {
+                line_cache_unlink(entry);
+                line_cache_push_head(entry);
+            }
+            return y_start + entry->num_wrapped * line_height;
+        }
+    }
+
+    draw_entry_lines(r, entry, x_start, y_start, rate, clip_top, clip_bottom);
+    return y_start + entry->num_wrapped * line_height;
+}
+
+// Ingest thread: tell the main loop there is something to pop, once until it has looked.
+void ingest_wake_main() {
+    if (SDL_AtomicSet(&ingest.wake_pending, 1) == 0) {
+        SDL_Event wake;
+        memset(&wake, 0, sizeof(wake));
+        wake.type = ingest.event_type;
+        SDL_PushEvent(&wake);
+    }
+}
+
+// Ingest thread. Waits while the ring is full; returns false if told to quit meanwhile.
+bool ingest_push(IngestKind kind, ChatEntry* entry, off_t offset) {
+    unsigned tail = (unsigned)SDL_AtomicGet(&ingest.tail);
+    while (tail - (unsigned)SDL_AtomicGet(&ingest.head) >= INGEST_RING_SIZE) {
+        if (SDL_AtomicGet(&ingest.quit)) return false;
+        ingest_wake_main();
+        SDL_Delay(1);
+    }
+    IngestItem* item = &ingest.ring[tail & (INGEST_RING_SIZE - 1)];
+    item->kind = kind;
+    item->entry = entry;
+    item->offset = offset;
+    SDL_MemoryBarrierRelease();
+    SDL_AtomicSet(&ingest.tail, (int)(tail + 1));
+    return true;
+}
+
+// Main loop.
+bool ingest_pop(IngestItem* item) {
+    unsigned head = (unsigned)SDL_AtomicGet(&ingest.head);
+    if (head == (unsigned)SDL_AtomicGet(&ingest.tail)) return false;
+    SDL_MemoryBarrierAcquire();
+    *item = ingest.ring[head & (INGEST_RING_SIZE - 1)];
+    SDL_AtomicSet(&ingest.head, (int)(head + 1));
+    return true;
+}
+
+bool reuse_set_contains(uint32_t hash) {
+    if (hash == 0) hash = 1;
+    for (uint32_t i = hash & ingest.reuse_mask; ingest.reuse_set[i]; i = (i + 1) & ingest.reuse_mask) {
+        if (ingest.reuse_set[i] == hash) return true;
+    }
+    return false;
+}
+
+// Ingest thread: turn one line into a finished entry and hand it over.
+void ingest_line(const char* line, uint8_t speaker_color, off_t offset) {
+    if (!line || strlen(line) == 0) return;
+
+    // Mid-reload, a line the main loop still holds goes over unwrapped and takes over the old entry.
+    bool reusable = ingest.reuse_set && reuse_set_contains(hash_line(line));
+    ChatEntry* entry = new_chat_entry(line, !reusable, speaker_color);
+    if (!entry) return;
+    entry->offset = offset;
+
+    ingest.delivered[ingest.delivered_next] = entry->hash;
+    ingest.delivered_next = (ingest.delivered_next + 1) % max_entries;
+    if (ingest.delivered_count < max_entries) ingest.delivered_count++;
+
+    if (!ingest_push(INGEST_ENTRY, entry, 0)) free_chat_entry(entry);
+}
+
+// Leading timestamp of a line ("2024-05-01 12:00:01", "[12:00:01]", ...): digits and the
+// separators around them, compared as text. Returns its length, 0 if the line has none.
+size_t line_timestamp(const char* line) {
+    size_t len = strspn(line, "0123456789-:./T[] ");
+    while (len > 0 && line[len - 1] == ' ') len--;
+    if (len >= MAX_STAMP) len = MAX_STAMP - 1;
+    for (size_t i = 0; i < len; i++) {
+        if (line[i] >= '0' && line[i] <= '9') return len;
+    }
+    return 0;
+}
+
+int compare_merge_lines(const void* a, const void* b) {
+    const MergeLine* x = (const MergeLine*)a;
+    const MergeLine* y = (const MergeLine*)b;
+    int order = strcmp(x->stamp, y->stamp);
+    if (order != 0) return order;
+    return (x->seq > y->seq) - (x->seq < y->seq);
+}
+
+// Ingest lines held by source_line, in timestamp order with --merge time. With keep > 0 only
+// the newest keep go through (loading tails).
+void merge_flush(int keep) {
+    if (merge_by_time) qsort(merge.lines, merge.count, sizeof(MergeLine), compare_merge_lines);
+    int first = (keep > 0 && merge.count > keep) ? merge.count - keep : 0;
+    for (int i = first; i < merge.count; i++) ingest_line(merge.text + merge.lines[i].text, merge.lines[i].color, -1);
+    merge.count = 0;
+    merge.text_len = 0;
+}
+
+// Ingest thread: a complete line from src. With one source, or live lines merged by arrival,
+// it goes straight through; otherwise it waits in merge for merge_flush.
+void source_line(LogSource* src, const char* line, off_t offset) {
+    if (num_sources == 1 || (!merge_loading && !merge_by_time)) {
+        ingest_line(line, src->color, num_sources == 1 ? offset : -1);
+        return;
+    }
+
+    size_t len = strlen(line);
+    if (merge.count == merge.cap || merge.text_len + len + 1 > merge.text_cap) {
+        int cap = merge.count == merge.cap ? (merge.cap ? merge.cap * 2 : 1024) : merge.cap;
+        size_t text_cap = merge.text_cap;
+        while (merge.text_len + len + 1 > text_cap) text_cap = text_cap ? text_cap * 2 : 64 * 1024;
+        MergeLine* lines = (MergeLine*)realloc(merge.lines, cap * sizeof(MergeLine));
+        if (lines) merge.lines = lines;
+        char* text = lines ? (char*)realloc(merge.text, text_cap) : NULL;
+        if (text) merge.text = text;
+        if (!lines || !text) {
+            ingest_line(line, src->color, -1);  // Out of order rather than lost.
+            return;
+        }
+        merge.cap = cap;
+        merge.text_cap = text_cap;
+    }
+
+    MergeLine* merged = &merge.lines[merge.count];
+    merged->text = merge.text_len;
+    merged->seq = (uint32_t)merge.count++;
+    merged->color = src->color;
+    memcpy(merge.text + merge.text_len, line, len + 1);
+    merge.text_len += len + 1;
+
+    // A line without a timestamp sorts with the one before it from the same source.
+    size_t stamp_len = merge_by_time ? line_timestamp(line) : 0;
+    if (stamp_len > 0) {
+        memcpy(src->stamp, line, stamp_len);
+        src->stamp[stamp_len] = '\0';
+    }
+    memcpy(merged->stamp, src->stamp, MAX_STAMP);
+}
+
+// Read exactly len bytes at offset. False if the read failed or the log shrank meanwhile.
+bool read_at(int fd, char* buf, size_t len, off_t offset) {
+    while (len > 0) {
+        ssize_t got = pread(fd, buf, len, offset);
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) return false;
+        buf += got;
+        len -= got;
+        offset += got;
+    }
+    return true;
+}
+
+// Find where the last max_lines non-empty lines of fd start, reading back from size a block at a
+// time. Sets *end after the last complete line. Returns -1 if the log could not be read through.
+off_t find_tail(int fd, off_t size, int max_lines, off_t* end) {
+    char* block = (char*)malloc(TAIL_READ_BLOCK);
+    if (!block) return -1;
+    off_t start = 0;
+    int lines = 0;
+    *end = -1;
+    for (off_t block_end = size; block_end > 0 && lines < max_lines; ) {
+        off_t block_start = block_end > TAIL_READ_BLOCK ? block_end - TAIL_READ_BLOCK : 0;
+        if (!read_at(fd, block, block_end - block_start, block_start)) {
+            free(block);
+            return -1;
+        }
+        const char* nl;
+        size_t n = block_end - block_start;
+        while (lines < max_lines && (nl = (const char*)memrchr(block, '\n', n)) != NULL) {
+            n = nl - block;
+            off_t at = block_start + n;
+            if (*end < 0) *end = at + 1;  // A trailing partial line is left for poll_log_file.
+            else if (start - 1 > at + 1) lines++;  // add_chat_entry ignores empty lines.
+            start = at + 1;
+        }
+        block_end = block_start;
+    }
+    free(block);
+    if (*end < 0) *end = 0;
+    else if (lines < max_lines) start = 0;  // The first line of the log is in too.
+    return start;
+}
+
+// Find where max_lines lines after start end, reading forward a block at a time, or size if
+// fewer lines are left. Returns -1 if the log could not be read that far.
+off_t find_lines_after(int fd, off_t start, off_t size, int max_lines) {
+    char* block = (char*)malloc(TAIL_READ_BLOCK);
+    if (!block) return -1;
+    off_t end = size;
+    int lines = 0;
+    for (off_t block_start = start; block_start < size && lines < max_lines; ) {
+        size_t n = size - block_start < TAIL_READ_BLOCK ? (size_t)(size - block_start) : TAIL_READ_BLOCK;
+        if (!read_at(fd, block, n, block_start)) {
+            end = -1;
+            break;
+        }
+        const char* nl = block;
+        while (lines < max_lines && (nl = (const char*)memchr(nl, '\n', block + n - nl)) != NULL) {
+            nl++;
+            if (++lines == max_lines) end = block_start + (nl - block);
+        }
+        block_start += n;
+    }
+    free(block);
+    return end;
+}
+
+// Split the log bytes [start, end), held in data, into entries with the same chunking as
+// read_new_lines' fgets buffer: for source_line, or with page set as INGEST_PAGE_LINE entries.
+// end may fall mid-line at a chunk boundary.
+int split_lines(LogSource* src, const char* data, off_t start, off_t end, bool page) {
+    int added = 0;
+    char buffer[LINE_BUFFER];
+    for (off_t pos = start; pos < end; ) {
+        const char* nl = (const char*)memchr(data + (pos - start), '\n', end - pos);
+        off_t line_end = nl ? start + (nl - data) : end;
+        do {
+            size_t len = line_end - pos < (off_t)sizeof(buffer) - 1 ? (size_t)(line_end - pos) : sizeof(buffer) - 1;
+            memcpy(buffer, data + (pos - start), len);
+            buffer[len] = '\0';
+            if (len == 0) {
+                // add_chat_entry ignores empty lines.
+            } else if (!page) {
+                source_line(src, buffer, pos);
+                added++;
+            } else {
+                // Not wrapped until drawn: most of a page is scrolled past or never reached.
+                ChatEntry* entry = new_chat_entry(buffer, false, src->color);
+                if (entry) {
+                    entry->offset = pos;
+                    entry->tag_ns = 0;
+                    if (!ingest_push(INGEST_PAGE_LINE, entry, 0)) free_chat_entry(entry);
+                    added++;
+                }
+            }
+            pos += len;
+        } while (pos < line_end);
+        pos = line_end + 1;
+    }
+    return added;
+}
+
+// Answer the main loop's page request: up to HISTORY_PAGE_LINES lines ending at the offset it
+// gave, found by reading back from it the way the tail is, or as many starting there. Costs the
+// page, not the log before it. Always sends INGEST_PAGE_BEGIN and INGEST_PAGE_END, with nothing
+// between when there is nothing to page.
+void page_serve() {
+    SDL_AtomicLock(&ingest.page_lock);
+    bool wanted = ingest.page_wanted;
+    bool before = ingest.page_before;
+    off_t offset = ingest.page_offset;
+    ingest.page_wanted = false;
+    SDL_AtomicUnlock(&ingest.page_lock);
+    if (!wanted) return;
+
+    LogSource* src = &sources[0];
+    off_t start = offset, end = offset;
+    if (num_sources == 1 && src->file && offset >= 0 && offset <= src->pos) {
+        int fd = fileno(src->file);
+        off_t line_end;  // Before a mid-line offset, the line's first chunks are in the page too.
+        if (before) start = find_tail(fd, offset, HISTORY_PAGE_LINES, &line_end);
+        else end = find_lines_after(fd, offset, src->pos, HISTORY_PAGE_LINES);
+        if (start < 0 || end < 0) start = end = offset;  // Shrank meanwhile: the reload starts over.
+    }
+
+    ingest_push(INGEST_PAGE_BEGIN, NULL, start);
+    int added = 0;
+    if (end > start) {
+        // Only the page itself is read, and a log truncated meanwhile just comes up short.
+        char* data = (char*)malloc(end - start);
+        if (data && read_at(fileno(src->file), data, end - start, start)) {
+            added = split_lines(src, data, start, end, true);
+        } else if (DEBUG) fprintf(stderr, "Could not read %s at %ld, page not read\n", src->path, (long)start);
+        free(data);
+    }
+    ingest_push(INGEST_PAGE_END, NULL, end);
+    ingest_wake_main();
+    if (DEBUG) printf("Paged %d lines from %ld-%ld of %s\n", added, (long)start, (long)end, src->path);
+}
+
+// Remember the bytes just before src->pos, so a file truncated and
+// rewritten past that point between two polls is still noticed.
+void log_remember_tail(LogSource* src) {
+    src->tail_check_len = 0;
+    if (!src->file || src->pos == 0) return;
+    off_t len = src->pos < TAIL_CHECK_LEN ? src->pos : TAIL_CHECK_LEN;
+    ssize_t got = pread(fileno(src->file), src->tail_check, len, src->pos - len);
+    src->tail_check_len = got > 0 ? (int)got : 0;
+}
+
+bool log_tail_matches(LogSource* src) {
+    if (src->tail_check_len == 0) return true;
+    char current[TAIL_CHECK_LEN];
+    ssize_t got = pread(fileno(src->file), current, src->tail_check_len, src->pos - src->tail_check_len);
+    return got == src->tail_check_len && memcmp(current, src->tail_check, src->tail_check_len) == 0;
+}
+
+// Read complete lines from src->pos to EOF. A trailing partial line is left for the next poll.
+int read_new_lines(LogSource* src) {
+    int added = 0;
+    char buffer[LINE_BUFFER];
+    memset(buffer, 0, sizeof(buffer));
+    clearerr(src->file);
+    fseek(src->file, src->pos, SEEK_SET);
+    while (fgets(buffer, sizeof(buffer), src->file) != NULL) {
+        // Trim newline
+        size_t len = strlen(buffer);
+        if (len > 0 && buffer[len - 1] == '\n') buffer[len - 1] = '\0';
+        else if (feof(src->file)) break;  // Writer is mid-line.
+        source_line(src, buffer, src->pos);
+        added++;
+        src->pos = ftell(src->file);
+
+        // Re-zero
+        memset(buffer, 0, sizeof(buffer));
+    }
+    log_remember_tail(src);
+    return added;
+}
+
+// Load the last max_lines non-empty lines by reading backwards from EOF, so the cost depends on
+// max_lines rather than on the size of the log. Leaves src->pos after them. Read rather than
+// mapped: a log truncated while it is read would otherwise fault on the pages past its new end.
+int load_log_tail(LogSource* src, int max_lines) {
+    src->pos = 0;
+    src->tail_check_len = 0;
+
+    struct stat st;
+    if (fstat(fileno(src->file), &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+        return read_new_lines(src);
+    }
+    off_t end;
+    off_t start = find_tail(fileno(src->file), st.st_size, max_lines, &end);
+    char* data = start >= 0 ? (char*)malloc(end - start + 1) : NULL;
+    if (!data || !read_at(fileno(src->file), data, end - start, start)) {
+        if (DEBUG) fprintf(stderr, "Tail of %s not read (%s), reading from the start\n", src->path, strerror(errno));
+        free(data);
+        return read_new_lines(src);
+    }
+
+    int added = split_lines(src, data, start, end, false);
+
+    free(data);
+    src->pos = end;
+    log_remember_tail(src);
+    if (DEBUG) printf("Loaded %d lines of %s from the last %ld of %ld bytes\n", added, src->path, (long)(end - start), (long)st.st_size);
+    return added;
+}
+
+// The newest max_entries lines across all sources: each one's tail, merged. By arrival there is
+// no order between sources' histories, so each gets an even share, one after the other.
+int load_sources_tail() {
+    if (num_sources == 1) return sources[0].file ? load_log_tail(&sources[0], max_entries) : 0;
+    int share = merge_by_time ? max_entries : (max_entries + num_sources - 1) / num_sources;
+    int added = 0;
+    merge_loading = true;
+    for (int i = 0; i < num_sources; i++) {
+        if (sources[i].file) added += load_log_tail(&sources[i], share);
+    }
+    merge_loading = false;
+    merge_flush(max_entries);
+    return added;
+}
+
+// Rebuild chat_log from the sources after a truncation or a switch to a new file.
+// Lines the main loop already holds are sent unwrapped and take over their old entries.
+int reload_chat_log() {
+    merge.count = 0;  // Read again below.
+    merge.text_len = 0;
+    uint32_t slots = 1;
+    while (slots < (uint32_t)max_entries * 2) slots <<= 1;
+    ingest.reuse_set = (uint32_t*)calloc(slots, sizeof(uint32_t));
+    ingest.reuse_mask = slots - 1;
+    for (int i = 0; ingest.reuse_set && i < ingest.delivered_count; i++) {
+        uint32_t hash = ingest.delivered[i] ? ingest.delivered[i] : 1;
+        uint32_t j = hash & ingest.reuse_mask;
+        while (ingest.reuse_set[j] && ingest.reuse_set[j] != hash) j = (j + 1) & ingest.reuse_mask;
+        ingest.reuse_set[j] = hash;
+    }
+    ingest.delivered_next = 0;
+    ingest.delivered_count = 0;
+
+    ingest_push(INGEST_RELOAD_BEGIN, NULL, 0);
+    int added = load_sources_tail();
+    ingest_push(INGEST_RELOAD_END, NULL, 0);
+
+    free(ingest.reuse_set);
+    ingest.reuse_set = NULL;
+    return added;
+}
+
+// The watched name may now refer to a different file: switch to it and rebuild from its contents.
+int log_reopen(LogSource* src) {
+    FILE* fp = fopen(src->path, "r");
+    if (!fp) return 0;  // No replacement yet; keep following the old file.
+
+    struct stat old_stat, new_stat;
+    if (src->file && fstat(fileno(src->file), &old_stat) == 0 && fstat(fileno(fp), &new_stat) == 0 &&
+        old_stat.st_ino == new_stat.st_ino && old_stat.st_dev == new_stat.st_dev) {
+        fclose(fp);
+        return 0;  // Still the same file.
+    }
+
+    if (src->file) {
+#ifdef __linux__
+        // Drop the watch before closing, or the close itself reports IN_DELETE_SELF.
+        if (src->file_wd >= 0) inotify_rm_watch(ingest.inotify_fd, src->file_wd);
+        src->file_wd = -1;
+#endif
+        fclose(src->file);
+    }
+    src->file = fp;
+#ifdef __linux__
+    if (ingest.inotify_fd >= 0) {
+        src->file_wd = inotify_add_watch(ingest.inotify_fd, src->path, IN_MODIFY | IN_MOVE_SELF | IN_DELETE_SELF);
+    }
+#endif
+    if (DEBUG) printf("Reopened %s\n", src->path);
+    return reload_chat_log();
+}
+
+// Ingest thread, after an inotify event or, without inotify, every IDLE_POLL_MS.
+// Returns the number of lines read.
+int poll_log_file(LogSource* src, bool reopen) {
+    int added = 0;
+    if (ingest.inotify_fd >= 0) {
+        if (reopen) added += log_reopen(src);
+    } else {
+        struct stat file_stat;
+        if (stat(src->path, &file_stat) != 0) {
+            if (DEBUG) fprintf(stderr, "Stat failed for %s: %s\n", src->path, strerror(errno));
+            return 0;
+        }
+        if (file_stat.st_mtime <= src->mod_time && file_stat.st_size == src->pos) {
+            return 0;  // No change
+        }
+        src->mod_time = file_stat.st_mtime;
+        struct stat open_stat;
+        if (!src->file || (fstat(fileno(src->file), &open_stat) == 0 && open_stat.st_ino != file_stat.st_ino)) {
+            added += log_reopen(src);  // Created or rotated.
+        }
+    }
+    if (!src->file) return added;
+
+    // File changed: a shrink or different bytes before our position means it was truncated.
+    struct stat file_stat;
+    if (fstat(fileno(src->file), &file_stat) == 0 && (file_stat.st_size < src->pos || !log_tail_matches(src))) {
+        if (DEBUG) printf("%s truncated (size %ld, was at %ld)\n", src->path, (long)file_stat.st_size, (long)src->pos);
+        added += reload_chat_log();
+    } else {
+        added += read_new_lines(src);
+    }
+
+    if (DEBUG) printf("Polled %s: Read %d lines\n", src->path, added);
+    return added;
+}
+
+int ingest_thread(void* data) {
+    (void)data;
+
+    // Initial load: only the tail that fits in chat_log.
+    load_sources_tail();
+    ingest_wake_main();
+
+    // One inotify descriptor covers every source.
+    struct pollfd fds[2] = {{ingest.wake_pipe[0], POLLIN, 0}, {ingest.inotify_fd, POLLIN, 0}};
+    int nfds = ingest.inotify_fd >= 0 ? 2 : 1;
+    while (!SDL_AtomicGet(&ingest.quit)) {
+        if (poll(fds, nfds, ingest.inotify_fd >= 0 ? -1 : IDLE_POLL_MS) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        if (fds[0].revents) {
+            // Shutdown, or the main loop wants a page.
+            char wake[16];
+            if (read(ingest.wake_pipe[0], wake, sizeof(wake)) <= 0 || SDL_AtomicGet(&ingest.quit)) break;
+            page_serve();
+            continue;
+        }
+
+        bool poll_all = ingest.inotify_fd < 0;  // The stat() fallback looks on every timeout.
+#ifdef __linux__
+        char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+        ssize_t len = nfds == 2 && fds[1].revents ? read(ingest.inotify_fd, buf, sizeof(buf)) : 0;
+        for (char* p = buf; p < buf + len; ) {
+            struct inotify_event* ev = (struct inotify_event*)p;
+            for (int i = 0; i < num_sources; i++) {
+                LogSource* src = &sources[i];
+                if (ev->wd == src->file_wd) {
+                    if (ev->mask & (IN_MOVE_SELF | IN_DELETE_SELF)) src->reopen = true;
+                    src->changed = true;
+                } else if (ev->wd == src->dir_wd && ev->len > 0 && strcmp(ev->name, src->name) == 0) {
+                    src->reopen = true;  // Rotated: a new file took the name.
+                    src->changed = true;
+                }
+            }
+            p += sizeof(struct inotify_event) + ev->len;
+        }
+#endif
+        bool changed = false;
+        for (int i = 0; i < num_sources; i++) {
+            LogSource* src = &sources[i];
+            if (!poll_all && !src->changed) continue;
+            poll_log_file(src, src->reopen);
+            src->changed = src->reopen = false;
+            changed = true;
+        }
+        if (changed) {
+            if (merge.count > 0) merge_flush(0);  // This round's lines from every source, in order.
+            ingest_wake_main();  // Even with nothing sent: a reload may have emptied the log.
+        }
+    }
+    return 0;
+}
+
+int ingest_start() {
+    ingest.delivered = (uint32_t*)calloc(max_entries, sizeof(uint32_t));
+    if (!ingest.delivered) return 1;
+    ingest.event_type = SDL_RegisterEvents(1);
+    if (ingest.event_type == (Uint32)-1) return 1;
+    if (pipe(ingest.wake_pipe) != 0) return 1;
+
+#ifdef __linux__
+    ingest.inotify_fd = inotify_init1(IN_CLOEXEC);
+    for (int i = 0; ingest.inotify_fd >= 0 && i < num_sources; i++) {
+        // Directory watch sees the log being created or replaced under the same name.
+        // Sources in one directory share its watch.
+        LogSource* src = &sources[i];
+        char dir[4096];
+        const char* slash = strrchr(src->path, '/');
+        if (slash) {
+            snprintf(dir, sizeof(dir), "%.*s", (int)(slash - src->path), src->path);
+            if (dir[0] == '\0') strcpy(dir, "/");
+            src->name = slash + 1;
+        } else {
+            strcpy(dir, ".");
+            src->name = src->path;
+        }
+        src->dir_wd = inotify_add_watch(ingest.inotify_fd, dir, IN_CREATE | IN_MOVED_TO);
+        src->file_wd = inotify_add_watch(ingest.inotify_fd, src->path, IN_MODIFY | IN_MOVE_SELF | IN_DELETE_SELF);
+    }
+#endif
+    if (ingest.inotify_fd < 0 && DEBUG) printf("inotify unavailable, polling %d logs every %d ms\n", num_sources, IDLE_POLL_MS);
+
+    ingest.thread = SDL_CreateThread(ingest_thread, "ingest", NULL);
+    return ingest.thread ? 0 : 1;
+}
+
+void ingest_stop() {
+    if (ingest.thread) {
+        SDL_AtomicSet(&ingest.quit, 1);
+        if (write(ingest.wake_pipe[1], "q", 1) != 1) {
+            if (DEBUG) fprintf(stderr, "Ingest wake failed: %s\n", strerror(errno));
+        }
+        SDL_WaitThread(ingest.thread, NULL);
+        ingest.thread = NULL;
+    }
+    IngestItem item;
+    while (ingest_pop(&item)) {
+        if (item.entry) free_chat_entry(item.entry);
+    }
+    reload_pool_release();
+    for (int i = 0; i < 2; i++) {
+        if (ingest.wake_pipe[i] >= 0) close(ingest.wake_pipe[i]);
+    }
+    if (ingest.inotify_fd >= 0) close(ingest.inotify_fd);
+    free(ingest.delivered);
+    free(merge.lines);
+    free(merge.text);
+}
+
+// Add a log to tail. A path with wildcards adds every file it matches when tc starts.
+int add_source(const char* path) {
+    glob_t matches;
+    bool pattern = strpbrk(path, "*?[") != NULL;
+    if (pattern && glob(path, 0, NULL, &matches) != 0) {
+        fprintf(stderr, "No logs match '%s'\n", path);
+        return 1;
+    }
+    size_t count = pattern ? matches.gl_pathc : 1;
+    LogSource* grown = (LogSource*)realloc(sources, (num_sources + count) * sizeof(LogSource));
+    if (!grown) {
+        if (pattern) globfree(&matches);
+        return 1;
+    }
+    sources = grown;
+    for (size_t i = 0; i < count; i++) {
+        LogSource* src = &sources[num_sources];
+        memset(src, 0, sizeof(LogSource));
+        src->path = strdup(pattern ? matches.gl_pathv[i] : path);
+        if (!src->path) break;
+        src->name = src->path;
+        src->file_wd = src->dir_wd = -1;
+        src->color = PALETTE_SPEAKER;
+        num_sources++;
+    }
+    if (pattern) globfree(&matches);
+    return 0;
+}
+
+// Open every source and, with more than one, give each its own speaker color: the first keeps
+// the default (F2 still changes it), the rest take palette slots in turn.
+void open_sources() {
+    int first_slot = palette_size;
+    int slots = 0;
+    for (int i = 0; i < num_sources; i++) {
+        LogSource* src = &sources[i];
+        src->file = fopen(src->path, "r");
+        if (!src->file) {
+            fprintf(stderr, "Warning: Could not open log file '%s'—create it with chat lines.\n", src->path);
+        }
+        if (i == 0) continue;
+        int k = (i - 1) % SOURCE_COLORS;
+        if (k == slots && palette_size < PALETTE_SIZE) {
+            palette[palette_size++] = source_colors[k];
+            slots++;
+        }
+        if (k < slots) src->color = (uint8_t)(first_slot + k);
+    }
+}
+
+void close_sources() {
+    for (int i = 0; i < num_sources; i++) {
+        if (sources[i].file) fclose(sources[i].file);
+        free((char*)sources[i].path);
+    }
+    free(sources);
+    sources = NULL;
+    num_sources = 0;
+}
+
+// One entry rewrapped off the main thread. The job pins entry->chunk so a freed entry stays readable.
+typedef struct {
+    ChatEntry* entry;
+    int slot;
+    LineSpan* wrapped;   // Result, in the worker's arena.
+    ArenaChunk* chunk;
+    int num_wrapped;
+    SDL_atomic_t ready;
+} RewrapJob;
+
+typedef struct {
+    RewrapJob* jobs;  // NULL when no pass is running.
+    int num_jobs;
+    int committed;    // Main loop: jobs before this are applied or dropped.
+    int width;
+    int serial;
+    SDL_atomic_t next;  // Next job for a worker to claim.
+    SDL_atomic_t cancel;
+    SDL_Thread* workers[REWRAP_MAX_WORKERS];
+    int num_workers;
+} Rewrap;
+
+Rewrap rewrap;
+
+int rewrap_worker(void* data) {
+    (void)data;
+    ArenaChunk* arena = NULL;
+    LineSpan spans[LINE_BUFFER];
+    while (!SDL_AtomicGet(&rewrap.cancel)) {
+        int i = SDL_AtomicAdd(&rewrap.next, 1);
+        if (i >= rewrap.num_jobs) break;
+        RewrapJob* job = &rewrap.jobs[i];
+        int num_wrapped = wrap_text(job->entry->original_line, rewrap.width, spans, LINE_BUFFER);
+        if (num_wrapped > LINE_BUFFER) num_wrapped = LINE_BUFFER;
+        job->wrapped = (LineSpan*)arena_alloc(&arena, num_wrapped * sizeof(LineSpan), &job->chunk);
+        if (job->wrapped) memcpy(job->wrapped, spans, num_wrapped * sizeof(LineSpan));
+        job->num_wrapped = job->wrapped ? num_wrapped : 0;
+        SDL_AtomicSet(&job->ready, 1);
+    }
+    if (arena) arena_release(arena);
+    return 0;
+}
+
+// Stop the running pass and drop whatever it has not applied yet.
+void rewrap_cancel() {
+    if (!rewrap.jobs) return;
+    SDL_AtomicSet(&rewrap.cancel, 1);
+    for (int i = 0; i < rewrap.num_workers; i++) SDL_WaitThread(rewrap.workers[i], NULL);
+    for (int i = rewrap.committed; i < rewrap.num_jobs; i++) {
+        RewrapJob* job = &rewrap.jobs[i];
+        if (SDL_AtomicGet(&job->ready) && job->wrapped) arena_release(job->chunk);
+        arena_release(job->entry->chunk);
+    }
+    free(rewrap.jobs);
+    rewrap.jobs = NULL;
+    rewrap.num_workers = 0;
+    rewrap_needed = true;  // Whatever was left still has the old width.
+}
+
+// Main loop: give the entry at logical index i its new wrapping and keep the view on the same text.
+void rewrap_apply(int i, int old_height, int* view_y_offset) {
+    ChatEntry* entry = chat_at(i);
+    int slot = (chat_log_head + i) % max_entries;
+    int delta = entry->rendered_height - old_height;
+    if (delta == 0) return;
+    if (chat_height_before(i) + old_height <= *view_y_offset) *view_y_offset += delta;  // Above the view.
+    height_index_add(slot, delta);
+    line_cache_drop(entry);
+}
+
+// Main loop: rewrap everything under the current wrap_serial. Entries on screen are done right away,
+// nearest first; the rest of the scrollback is handed to workers and applied by rewrap_commit.
+void rewrap_start(int* view_y_offset, bool follow_tail) {
+    rewrap_cancel();
+    rewrap_needed = false;
+    if (chat_log_size == 0) return;
+    int serial = SDL_AtomicGet(&wrap_serial);
+
+    // Entries on screen: up from the bottom when following, else down from the first visible.
+    int first, last;
+    if (follow_tail) {
+        int covered = 0;
+        last = chat_log_size - 1;
+        for (first = last; first >= 0 && covered < screen_height; first--) {
+            ChatEntry* entry = chat_at(first);
+            int old_height = entry->rendered_height;
+            if (entry->wrap_serial != serial) {
+                wrap_chat_entry(entry);
+                rewrap_apply(first, old_height, view_y_offset);
+            }
+            covered += entry->rendered_height;
+        }
+        first++;
+    } else {
+        first = (*view_y_offset > 0) ? chat_index_at(*view_y_offset) : 0;
+        if (first >= chat_log_size) first = chat_log_size - 1;
+        int y = chat_height_before(first) - *view_y_offset;
+        for (last = first; last < chat_log_size && y < screen_height; last++) {
+            ChatEntry* entry = chat_at(last);
+            int old_height = entry->rendered_height;
+            if (entry->wrap_serial != serial) {
+                wrap_chat_entry(entry);
+                rewrap_apply(last, old_height, view_y_offset);
+            }
+            y += entry->rendered_height;
+        }
+        last--;
+    }
+
+    // The rest, nearest to the screen first: below it, then up from it.
+    int num_jobs = 0;
+    for (int i = 0; i < chat_log_size; i++) {
+        if ((i < first || i > last) && chat_at(i)->wrap_serial != serial) num_jobs++;
+    }
+    if (num_jobs == 0) return;
+    rewrap.jobs = (RewrapJob*)calloc(num_jobs, sizeof(RewrapJob));
+    if (!rewrap.jobs) return;
+    rewrap.num_jobs = 0;
+    for (int i = last + 1; i < chat_log_size + first; i++) {
+        int index = (i < chat_log_size) ? i : first - 1 - (i - chat_log_size);
+        ChatEntry* entry = chat_at(index);
+        if (entry->wrap_serial == serial) continue;
+        RewrapJob* job = &rewrap.jobs[rewrap.num_jobs++];
+        job->entry = entry;
+        job->slot = (chat_log_head + index) % max_entries;
+        SDL_AtomicAdd(&entry->chunk->live, 1);  // Pin until applied or dropped.
+    }
+    rewrap.committed = 0;
+    rewrap.width = SDL_AtomicGet(&wrap_width);
+    rewrap.serial = serial;
+    SDL_AtomicSet(&rewrap.next, 0);
+    SDL_AtomicSet(&rewrap.cancel, 0);
+
+    int workers = SDL_GetCPUCount() - 1;
+    if (workers < 1) workers = 1;
+    if (workers > REWRAP_MAX_WORKERS) workers = REWRAP_MAX_WORKERS;
+    for (int i = 0; i < workers; i++) {
+        rewrap.workers[rewrap.num_workers] = SDL_CreateThread(rewrap_worker, "rewrap", NULL);
+        if (rewrap.workers[rewrap.num_workers]) rewrap.num_workers++;
+    }
+    if (rewrap.num_workers == 0) {
+        if (DEBUG) fprintf(stderr, "Rewrap threads failed: %s\n", SDL_GetError());
+        rewrap_cancel();
+    }
+    if (DEBUG) printf("Rewrapping %d entries at %dpx on %d threads\n", rewrap.num_jobs, rewrap.width, rewrap.num_workers);
+}
+
+// Main loop: apply finished jobs in order. Returns true if any entry changed.
+bool rewrap_commit(int* view_y_offset) {
+    if (!rewrap.jobs) return false;
+    bool changed = false;
+    while (rewrap.committed < rewrap.num_jobs && SDL_AtomicGet(&rewrap.jobs[rewrap.committed].ready)) {
+        RewrapJob* job = &rewrap.jobs[rewrap.committed++];
+        ChatEntry* entry = job->entry;
+        if (!entry->freed && chat_log[job->slot] == entry && entry->wrap_serial != rewrap.serial && job->wrapped) {
+            if (entry->spans_chunk) arena_release(entry->spans_chunk);
+            int old_height = entry->rendered_height;
+            entry->wrapped = job->wrapped;
+            entry->spans_chunk = job->chunk;
+            entry->num_wrapped = job->num_wrapped;
+            entry->rendered_height = job->num_wrapped * line_height;
+            entry->wrap_serial = rewrap.serial;
+            rewrap_apply((job->slot - chat_log_head + max_entries) % max_entries, old_height, view_y_offset);
+            changed = true;
+        } else if (job->wrapped) {
+            arena_release(job->chunk);  // Evicted meanwhile (into the history, it is wrapped when drawn).
+        }
+        arena_release(entry->chunk);
+    }
+    if (rewrap.committed == rewrap.num_jobs) {
+        for (int i = 0; i < rewrap.num_workers; i++) SDL_WaitThread(rewrap.workers[i], NULL);
+        free(rewrap.jobs);
+        rewrap.jobs = NULL;
+        rewrap.num_workers = 0;
+        if (DEBUG) printf("Rewrap done: %d entries, %d px total\n", chat_log_size, chat_log_height);
+    }
+    return changed;
+}
+
+// Main loop: link in whatever the ingest thread has finished. Returns true if chat_log changed.
+bool drain_ingest() {
+    SDL_AtomicSet(&ingest.wake_pending, 0);
+    bool changed = false;
+    IngestItem item;
+    while (ingest_pop(&item)) {
+        changed = true;
+        if (item.kind == INGEST_RELOAD_BEGIN) {
+            rewrap_cancel();  // Entries are about to change slots.
+            history_clear();  // Paged from the old contents.
+            reload_pool_fill();
+        }
+        else if (item.kind == INGEST_RELOAD_END) reload_pool_release();
+        else if (item.kind == INGEST_PAGE_BEGIN) history.incoming_start = item.offset;
+        else if (item.kind == INGEST_PAGE_LINE) history_page_line(item.entry);
+        else if (item.kind == INGEST_PAGE_END) history_page_end(item.offset);
+        else add_chat_entry(item.entry);
+    }
+    return changed;
+}
+
+// Bake the extracted glyph pixels into one white texture, tinted from the palette at draw time.
+// Built from the GMap pixels (not the raw surfaces) so it matches the per-pixel path exactly.
+int build_glyph_atlas(SDL_Renderer* r, GlyphSet* set) {
+    GMap* glyphs = set->glyphs;  // Not necessarily the live set yet.
+    int cell_w = 0, cell_h = set->max_height;
+    for (int c = 32; c < 127; c++) {
+        if (glyphs[c].width > cell_w) cell_w = glyphs[c].width;
+    }
+    if (cell_w == 0 || cell_h == 0) return 1;
+
+    int rows = (95 + ATLAS_COLUMNS - 1) / ATLAS_COLUMNS;
+    SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormat(0, cell_w * ATLAS_COLUMNS, cell_h * rows, 32, SDL_PIXELFORMAT_ARGB8888);
+    if (!surface) {
+        fprintf(stderr, "Atlas surface failed: %s\n", SDL_GetError());
+        return 1;
+    }
+    memset(surface->pixels, 0, surface->h * surface->pitch);
+
+    for (int c = 32; c < 127; c++) {
+        GMap* g = &glyphs[c];
+        g->atlas.x = ((c - 32) % ATLAS_COLUMNS) * cell_w;
+        g->atlas.y = ((c - 32) / ATLAS_COLUMNS) * cell_h;
+        g->atlas.w = g->width;
+        g->atlas.h = g->height;
+        for (int i = 0; i < g->num_pixels; i++) {
+            Pixel* p = &g->pixels[i];
+            Uint8* row = (Uint8*)surface->pixels + (g->atlas.y + p->y) * surface->pitch;
+            ((Uint32*)row)[g->atlas.x + p->x] = ((Uint32)p->a << 24) | 0x00FFFFFF;
+        }
+    }
+
+    set->atlas = SDL_CreateTextureFromSurface(r, surface);
+    SDL_FreeSurface(surface);
+    if (!set->atlas) {
+        fprintf(stderr, "Atlas texture failed: %s (using per-pixel path only)\n", SDL_GetError());
+        return 1;
+    }
+    SDL_SetTextureBlendMode(set->atlas, SDL_BLENDMODE_BLEND);
+    if (DEBUG) printf("Glyph atlas: %dx%d cells of %dx%d\n", ATLAS_COLUMNS, rows, cell_w, cell_h);
+    return 0;
+}
+
+// Append every pixel of an ARGB8888 surface with alpha > threshold to out. Returns the count.
+int scan_visible_pixels(SDL_Surface* surface, uint8_t threshold, Pixel* out) {
+    int count = 0;
+    for (int j = 0; j < surface->h; j++) {
+        const Uint32* row = (const Uint32*)((const Uint8*)surface->pixels + j * surface->pitch);
+        int i = 0;
+#ifdef __SSE2__
+        // Four pixels per compare; fully transparent runs cost one test.
+        const __m128i limit = _mm_set1_epi32(threshold);
+        for (; i + 4 <= surface->w; i += 4) {
+            __m128i alpha = _mm_srli_epi32(_mm_loadu_si128((const __m128i*)(row + i)), 24);
+            int mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(alpha, limit)));
+            while (mask) {
+                int k = __builtin_ctz(mask);
+                mask &= mask - 1;
+                Uint32 argb = row[i + k];
+                out[count++] = (Pixel){i + k, j, argb >> 16, argb >> 8, argb, argb >> 24};
+            }
+        }
+#endif
+        for (; i < surface->w; i++) {
+            Uint32 argb = row[i];
+            if ((argb >> 24) > threshold) out[count++] = (Pixel){i, j, argb >> 16, argb >> 8, argb, argb >> 24};
+        }
+    }
+    return count;
+}
+
+// Fill g's size and visible pixels from a rendered glyph, which it frees.
+// Returns the pixel count, or -1 if the surface could not be read.
+int extract_glyph(SDL_Surface* surface, uint8_t threshold, GMap* g) {
+    // Solid glyphs come back 8-bit paletted; scan everything as ARGB8888.
+    if (surface->format->format != SDL_PIXELFORMAT_ARGB8888) {
+        SDL_Surface* converted = SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_ARGB8888, 0);
+        SDL_FreeSurface(surface);
+        if (!converted) return -1;
+        surface = converted;
+    }
+    g->width = surface->w;
+    g->height = surface->h;
+    g->num_pixels = 0;
+    g->pixels = NULL;
+
+    // Single pass into a worst-case buffer, trimmed afterwards.
+    Pixel* pixels = (Pixel*)malloc((size_t)surface->w * surface->h * sizeof(Pixel));
+    if (!pixels) {
+        SDL_FreeSurface(surface);
+        return -1;
+    }
+    int count = scan_visible_pixels(surface, threshold, pixels);
+    SDL_FreeSurface(surface);
+    if (count == 0) {
+        free(pixels);
+        return 0;
+    }
+    Pixel* trimmed = (Pixel*)realloc(pixels, count * sizeof(Pixel));
+    g->pixels = trimmed ? trimmed : pixels;
+    g->num_pixels = count;
+    return count;
+}
+
+// Rasterize ASCII 32-126 through SDL_ttf into set. Safe off the main thread: every TTF call
+// holds font_lock, one glyph at a time so the live size keeps drawing.
+int rasterize_glyphs(GlyphSet* set, const char* path, uint8_t threshold)
+{
+    GMap* glyphs = set->glyphs;  // Not the live set.
+    int size = set->size;
+    SDL_LockMutex(font_lock);
+    TTF_Font* font = TTF_OpenFont(path, size);
+    SDL_UnlockMutex(font_lock);
+    if (!font) {
+        fprintf(stderr, "Font load failed: %s (check path: '%s')\n", TTF_GetError(), path);
+        return 1;
+    }
+    if(DEBUG) printf("Font loaded: %s, size %dpt (anti-aliased).\n", TTF_FontFaceFamilyName(font), size);
+
+    // Pre-load glyphs into GMap array (ASCII 32-126)
+    SDL_Color fg_color = {255, 255, 255, 255};  // White foreground
+    int loaded_glyphs = 0;
+    int empty_count = 0;
+
+    for (int c = 32; c < 127; c++) {
+        SDL_LockMutex(font_lock);
+        // Render blended (AA)
+        SDL_Surface* surface = TTF_RenderGlyph_Blended(font, (Uint16)c, fg_color);
+        bool use_blended = true;
+
+        // Fallback to solid if empty
+        if (!surface || surface->w == 0 || surface->h == 0) {
+            if (surface) {
+                SDL_FreeSurface(surface);
+                if (DEBUG && empty_count < 5) printf("Blended empty for '%c' (trying solid)\n", c);
+            } else {
+                if (DEBUG && empty_count < 5) printf("Blended NULL for '%c': %s (trying solid)\n", c, TTF_GetError());
+            }
+            surface = TTF_RenderGlyph_Solid(font, (Uint16)c, fg_color);
+            use_blended = false;
+        }
+        int advance = 0;
+        TTF_GlyphMetrics(font, (Uint16)c, NULL, NULL, NULL, &advance, NULL);
+        SDL_UnlockMutex(font_lock);
+
+        if (!surface || surface->w == 0 || surface->h == 0) {
+            int surf_w = surface ? surface->w : 0;
+            int surf_h = surface ? surface->h : 0;
+            if (surface) SDL_FreeSurface(surface);
+            empty_count++;
+            glyphs[c].width = 0;
+            glyphs[c].height = 0;
+            glyphs[c].num_pixels = 0;
+            glyphs[c].pixels = NULL;
+            glyphs[c].advance = 0;
+            if (DEBUG && (c == 'A' || empty_count < 3)) {
+                printf("Failed for '%c': w=%d h=%d, error: %s\n", c, surf_w, surf_h, TTF_GetError());
+            }
+            continue;
+        }
+
+        int stored_count = extract_glyph(surface, threshold, &glyphs[c]);
+        if (stored_count < 0) {
+            fprintf(stderr, "Pixel extraction failed for '%c': %s\n", c, SDL_GetError());
+            continue;
+        }
+        if (stored_count == 0) {
+            empty_count++;
+            glyphs[c].advance = 0;
+            continue;
+        }
+
+        // Store metadata
+        glyphs[c].advance = advance;
+        loaded_glyphs++;
+
+        // Debug samples
+        if (c == 'H' || c == 'e' || c == 'l' || c == 'o' || c == ' ' || c == 'A') {
+            if(DEBUG) printf("Glyph '%c': w=%d, h=%d, visible_pixels=%d, advance=%d (%s)\n", 
+                             c, glyphs[c].width, glyphs[c].height, stored_count, glyphs[c].advance, use_blended ? "AA blended" : "solid");
+        }
+    }
+
+    if(DEBUG) {
+        printf("Loaded %d glyphs into GMap array (%d empty). Sample 'A' (65): pixels=%d\n", 
+               loaded_glyphs, empty_count, glyphs[65].num_pixels);
+        if (empty_count > 90) printf("CRITICAL: Most glyphs empty—check font path.\n");
+    }
+
+    // Free
+    SDL_LockMutex(font_lock);
+    TTF_CloseFont(font);
+    SDL_UnlockMutex(font_lock);
+    set->loaded = loaded_glyphs;
+    return 0;
+}
+
+// Rasterized glyphs are cached on disk, keyed by font path, contents, size and threshold.
+// The file is [GlyphCacheHeader][GlyphCacheEntry x 95][Pixel...] and is mapped in place.
+typedef struct {
+    char magic[4];  // "TCGC"
+    uint32_t version;
+    uint64_t font_hash;
+    int32_t size;
+    int32_t threshold;
+    int32_t pixel_size;  // sizeof(Pixel), in case its layout changes.
+    int32_t glyph_count;
+} GlyphCacheHeader;
+
+typedef struct {
+    int32_t width, height, num_pixels, advance;
+    uint32_t first_pixel;
+} GlyphCacheEntry;
+
+uint64_t hash_bytes(uint64_t h, const void* data, size_t len) {
+    const unsigned char* p = (const unsigned char*)data;
+    for (size_t i = 0; i < len; i++) h = (h ^ p[i]) * 1099511628211ull;  // FNV-1a.
+    return h;
+}
+
+// FNV-1a of the font file, or 0 if it cannot be read.
+uint64_t hash_font_file(const char* path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return 0;
+    struct stat st;
+    uint64_t h = 0;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        void* data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) {
+            h = hash_bytes(14695981039346656037ull, data, st.st_size);
+            munmap(data, st.st_size);
+        }
+    }
+    close(fd);
+    return h;
+}
+
+// $XDG_CACHE_HOME/tc/<key>.glyphs, or ~/.cache/tc/...; false if there is no home to put it in.
+bool glyph_cache_path(char* out, size_t out_len, const char* font_path, uint64_t font_hash, int size, uint8_t threshold) {
+    char dir[512];
+    const char* xdg = getenv("XDG_CACHE_HOME");
+    const char* home = getenv("HOME");
+    if (xdg && xdg[0]) snprintf(dir, sizeof(dir), "%s/tc", xdg);
+    else if (home && home[0]) snprintf(dir, sizeof(dir), "%s/.cache/tc", home);
+    else return false;
+
+    uint64_t key = hash_bytes(font_hash, font_path, strlen(font_path));
+    int32_t params[3] = {size, threshold, GLYPH_CACHE_VERSION};
+    key = hash_bytes(key, params, sizeof(params));
+    return snprintf(out, out_len, "%s/%016llx.glyphs", dir, (unsigned long long)key) < (int)out_len;
+}
+
+int glyph_cache_load(GlyphSet* set, const char* cache_path, uint64_t font_hash, uint8_t threshold) {
+    int size = set->size;
+    int fd = open(cache_path, O_RDONLY);
+    if (fd < 0) return 1;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(GlyphCacheHeader) + 95 * sizeof(GlyphCacheEntry)) {
+        close(fd);
+        return 1;
+    }
+    size_t len = st.st_size;
+    void* map = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return 1;
+
+    const GlyphCacheHeader* header = (const GlyphCacheHeader*)map;
+    const GlyphCacheEntry* entries = (const GlyphCacheEntry*)(header + 1);
+    size_t pixels_at = sizeof(GlyphCacheHeader) + 95 * sizeof(GlyphCacheEntry);
+    size_t max_pixels = (len - pixels_at) / sizeof(Pixel);
+    bool valid = memcmp(header->magic, "TCGC", 4) == 0 && header->version == GLYPH_CACHE_VERSION &&
+                 header->font_hash == font_hash && header->size == size && header->threshold == threshold &&
+                 header->pixel_size == (int32_t)sizeof(Pixel) && header->glyph_count == 95;
+    // build_glyph_atlas sizes cells and writes pixels from these, so a damaged file must not get past here.
+    Pixel* pixels = (Pixel*)((char*)map + pixels_at);
+    int max_extent = 4 * size + 16;  // Well past any glyph surface TTF renders at this size.
+    for (int c = 32; c < 127 && valid; c++) {
+        const GlyphCacheEntry* e = &entries[c - 32];
+        valid = e->num_pixels >= 0 && e->first_pixel <= max_pixels && (size_t)e->num_pixels <= max_pixels - e->first_pixel &&
+                e->width >= 0 && e->width <= max_extent && e->height >= 0 && e->height <= max_extent;
+        for (int32_t i = 0; i < e->num_pixels && valid; i++) {
+            const Pixel* p = &pixels[e->first_pixel + i];
+            valid = p->x >= 0 && p->x < e->width && p->y >= 0 && p->y < e->height;
+        }
+    }
+    if (!valid) {
+        if (DEBUG) printf("Glyph cache %s is damaged or stale, rasterizing\n", cache_path);
+        munmap(map, len);
+        return 1;
+    }
+
+    GMap* glyphs = set->glyphs;
+    int loaded_glyphs = 0;
+    for (int c = 32; c < 127; c++) {
+        const GlyphCacheEntry* e = &entries[c - 32];
+        glyphs[c].width = e->width;
+        glyphs[c].height = e->height;
+        glyphs[c].num_pixels = e->num_pixels;
+        glyphs[c].advance = e->advance;
+        glyphs[c].pixels = e->num_pixels > 0 ? pixels + e->first_pixel : NULL;
+        if (e->num_pixels > 0) loaded_glyphs++;
+    }
+    set->loaded = loaded_glyphs;
+    set->cache_map = map;
+    set->cache_len = len;
+    return 0;
+}
+
+// Written to a temporary name and renamed, so a display starting alongside never maps half a file.
+void glyph_cache_save(GlyphSet* set, const char* cache_path, uint64_t font_hash, uint8_t threshold) {
+    const GMap* glyphs = set->glyphs;
+    int size = set->size;
+    char dir[512];
+    snprintf(dir, sizeof(dir), "%s", cache_path);
+    for (char* slash = strchr(dir + 1, '/'); slash; slash = strchr(slash + 1, '/')) {
+        *slash = '\0';
+        mkdir(dir, 0755);  // Existing parents fail with EEXIST, which is fine.
+        *slash = '/';
+    }
+
+    char tmp_path[600];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.%d.tmp", cache_path, (int)getpid());
+    FILE* f = fopen(tmp_path, "wb");
+    if (!f) {
+        if (DEBUG) fprintf(stderr, "Glyph cache %s: %s\n", tmp_path, strerror(errno));
+        return;
+    }
+
+    GlyphCacheHeader header = {{'T', 'C', 'G', 'C'}, GLYPH_CACHE_VERSION, font_hash, size, threshold, (int32_t)sizeof(Pixel), 95};
+    GlyphCacheEntry entries[95];
+    uint32_t first_pixel = 0;
+    for (int c = 32; c < 127; c++) {
+        entries[c - 32] = (GlyphCacheEntry){glyphs[c].width, glyphs[c].height, glyphs[c].num_pixels, glyphs[c].advance, first_pixel};
+        first_pixel += glyphs[c].num_pixels;
+    }
+    bool ok = fwrite(&header, sizeof(header), 1, f) == 1 && fwrite(entries, sizeof(entries), 1, f) == 1;
+    for (int c = 32; c < 127 && ok; c++) {
+        if (glyphs[c].num_pixels > 0) ok = fwrite(glyphs[c].pixels, sizeof(Pixel), glyphs[c].num_pixels, f) == (size_t)glyphs[c].num_pixels;
+    }
+    if (fclose(f) != 0) ok = false;
+    if (!ok || rename(tmp_path, cache_path) != 0) {
+        if (DEBUG) fprintf(stderr, "Glyph cache write failed: %s\n", strerror(errno));
+        unlink(tmp_path);
+        return;
+    }
+    if (DEBUG) printf("Glyph cache saved: %s (%u pixels)\n", cache_path, first_pixel);
+}
+
+// Non-ASCII glyphs, keyed by codepoint and filled in on first sight. Any thread may look up
+// advances and fill free slots with them; only the main loop rasterizes and evicts, so a GMap
+// from unicode_glyph stays valid until its next call.
+typedef struct {
+    uint32_t codepoint;
+    GMap g;
+    bool rasterized;
+    int next;      // Bucket chain, or free list once evicted; -1 ends.
+    int lru_prev;  // Most recent at unicode_lru_head.
+    int lru_next;
+} UnicodeGlyph;
+
+UnicodeGlyph unicode_glyphs[UNICODE_GLYPHS];
+int unicode_buckets[UNICODE_BUCKETS];
+int unicode_used = 0;  // Slots handed out so far, before any come back through unicode_free.
+int unicode_free = -1;
+int unicode_lru_head = -1;
+int unicode_lru_tail = -1;
+bool unicode_font_failed = false;  // Guarded by font_lock, like font and everything above.
+
+int unicode_init() {
+    for (int i = 0; i < UNICODE_BUCKETS; i++) unicode_buckets[i] = -1;
+    font_lock = SDL_CreateMutex();
+    return font_lock ? 0 : 1;
+}
+
+// Opened at the live size only once a non-ASCII glyph shows up; ASCII comes from glyph sets.
+TTF_Font* unicode_font() {
+    if (!font && !unicode_font_failed && loaded_font_path) {
+        font = TTF_OpenFont(loaded_font_path, loaded_font_size);
+        if (!font) {
+            fprintf(stderr, "Font reopen failed: %s (non-ASCII text left blank)\n", TTF_GetError());
+            unicode_font_failed = true;
+        }
+    }
+    return font;
+}
+
+int unicode_metrics(uint32_t codepoint) {
+    TTF_Font* f = unicode_font();
+    int advance = 0;
+    if (!f || !TTF_GlyphIsProvided32(f, codepoint)) return 20;  // Fallback, as get_advance.
+    TTF_GlyphMetrics32(f, codepoint, NULL, NULL, NULL, NULL, &advance);
+    return advance;
+}
+
+void unicode_lru_unlink(int i) {
+    UnicodeGlyph* u = &unicode_glyphs[i];
+    if (u->lru_prev >= 0) unicode_glyphs[u->lru_prev].lru_next = u->lru_next;
+    else unicode_lru_head = u->lru_next;
+    if (u->lru_next >= 0) unicode_glyphs[u->lru_next].lru_prev = u->lru_prev;
+    else unicode_lru_tail = u->lru_prev;
+}
+
+void unicode_lru_push_head(int i) {
+    UnicodeGlyph* u = &unicode_glyphs[i];
+    u->lru_prev = -1;
+    u->lru_next = unicode_lru_head;
+    if (unicode_lru_head >= 0) unicode_glyphs[unicode_lru_head].lru_prev = i;
+    unicode_lru_head = i;
+    if (unicode_lru_tail < 0) unicode_lru_tail = i;
+}
+
+int unicode_find(uint32_t codepoint) {
+    for (int i = unicode_buckets[codepoint % UNICODE_BUCKETS]; i >= 0; i = unicode_glyphs[i].next) {
+        if (unicode_glyphs[i].codepoint == codepoint) {
+            if (i != unicode_lru_head) {
+                unicode_lru_unlink(i);
+                unicode_lru_push_head(i);
+            }
+            return i;
+        }
+    }
+    return -1;
+}
+
+void unicode_evict(int i) {
+    UnicodeGlyph* u = &unicode_glyphs[i];
+    int* link = &unicode_buckets[u->codepoint % UNICODE_BUCKETS];
+    while (*link != i) link = &unicode_glyphs[*link].next;
+    *link = u->next;
+    unicode_lru_unlink(i);
+    free(u->g.pixels);
+    u->g.pixels = NULL;
+    u->next = unicode_free;
+    unicode_free = i;
+}
+
+// Returns -1 when full and not allowed to evict.
+int unicode_add(uint32_t codepoint, bool may_evict) {
+    if (unicode_free < 0 && unicode_used == UNICODE_GLYPHS) {
+        if (!may_evict) return -1;
+        unicode_evict(unicode_lru_tail);
+    }
+    int i;
+    if (unicode_free >= 0) {
+        i = unicode_free;
+        unicode_free = unicode_glyphs[i].next;
+    } else {
+        i = unicode_used++;
+    }
+    UnicodeGlyph* u = &unicode_glyphs[i];
+    memset(u, 0, sizeof(UnicodeGlyph));
+    u->codepoint = codepoint;
+    u->g.advance = unicode_metrics(codepoint);
+    u->next = unicode_buckets[codepoint % UNICODE_BUCKETS];
+    unicode_buckets[codepoint % UNICODE_BUCKETS] = i;
+    unicode_lru_push_head(i);
+    return i;
+}
+
+// Any thread: advance of a non-ASCII codepoint.
+int unicode_advance(uint32_t codepoint) {
+    SDL_LockMutex(font_lock);
+    int i = unicode_find(codepoint);
+    if (i < 0) i = unicode_add(codepoint, false);
+    int advance = (i >= 0) ? unicode_glyphs[i].g.advance : unicode_metrics(codepoint);
+    SDL_UnlockMutex(font_lock);
+    return advance;
+}
+
+// Main loop: glyph of a non-ASCII codepoint, rasterized the first time it is drawn.
+const GMap* unicode_glyph(uint32_t codepoint) {
+    SDL_LockMutex(font_lock);
+    int i = unicode_find(codepoint);
+    if (i < 0) i = unicode_add(codepoint, true);
+    UnicodeGlyph* u = &unicode_glyphs[i];
+    if (!u->rasterized) {
+        u->rasterized = true;
+        TTF_Font* f = unicode_font();
+        if (f && TTF_GlyphIsProvided32(f, codepoint)) {
+            SDL_Color fg_color = {255, 255, 255, 255};
+            SDL_Surface* surface = TTF_RenderGlyph32_Blended(f, codepoint, fg_color);
+            if (surface && extract_glyph(surface, GLYPH_THRESHOLD, &u->g) < 0 && DEBUG) {
+                fprintf(stderr, "Glyph U+%04X failed: %s\n", (unsigned)codepoint, SDL_GetError());
+            }
+        }
+        if (DEBUG) printf("Glyph U+%04X: %d pixels, advance %d\n", (unsigned)codepoint, u->g.num_pixels, u->g.advance);
+    }
+    SDL_UnlockMutex(font_lock);
+    return &u->g;
+}
+
+void unicode_clear() {
+    for (int i = 0; i < unicode_used; i++) free(unicode_glyphs[i].g.pixels);
+    unicode_used = 0;
+    unicode_free = -1;
+    unicode_lru_head = unicode_lru_tail = -1;
+    for (int i = 0; i < UNICODE_BUCKETS; i++) unicode_buckets[i] = -1;
+}
+
+void free_glyph_set(GlyphSet* set) {
+    for (int c = 0; c < 128; c++) {
+        if (set->glyphs[c].pixels && !set->cache_map) free(set->glyphs[c].pixels);
+    }
+    if (set->cache_map) munmap(set->cache_map, set->cache_len);
+    if (set->atlas) SDL_DestroyTexture(set->atlas);
+    free(set);
+}
+
+// Load glyphs for set->size from the disk cache, or rasterize and cache them. Any thread.
+int build_glyph_set(GlyphSet* set) {
+    uint8_t threshold = GLYPH_THRESHOLD;
+    char* path = loaded_font_path;
+    uint64_t font_hash = hash_font_file(path);
+    char cache_path[512];
+    bool cacheable = font_hash && glyph_cache_path(cache_path, sizeof(cache_path), path, font_hash, set->size, threshold);
+
+    if (cacheable && glyph_cache_load(set, cache_path, font_hash, threshold) == 0) {
+        if (DEBUG) printf("Glyph cache hit: %s (%d glyphs)\n", cache_path, set->loaded);
+    } else {
+        if (rasterize_glyphs(set, path, threshold) != 0) return 1;
+        if (cacheable && set->loaded > 0) glyph_cache_save(set, cache_path, font_hash, threshold);
+    }
+
+    // Spacing scales with the size; the startup size keeps the tuned constants.
+    set->line_height = (LINE_HEIGHT * set->size + base_font_size / 2) / base_font_size;
+    int space_advance = (SPACE_ADVANCE * set->size + base_font_size / 2) / base_font_size;
+    for (int c = 32; c < 127; c++) {
+        if (set->glyphs[c].height > set->max_height) set->max_height = set->glyphs[c].height;
+    }
+    for (int c = 0; c < 128; c++) {
+        if (c == ' ') set->advance_table[c] = space_advance > 0 ? space_advance : 1;
+        else if (c > 32 && c < 127 && set->glyphs[c].advance > 0) set->advance_table[c] = set->glyphs[c].advance;
+        else set->advance_table[c] = 20;  // Fallback, as get_advance.
+    }
+    return 0;
+}
+
+int glyph_set_thread(void* data) {
+    GlyphSet* set = (GlyphSet*)data;
+    set->status = build_glyph_set(set);
+    SDL_AtomicSet(&set->built, 1);
+    return 0;
+}
+
+GlyphSet* new_glyph_set(int size) {
+    GlyphSet* set = (GlyphSet*)calloc(1, sizeof(GlyphSet));
+    if (!set) return NULL;
+    set->size = size;
+    return set;
+}
+
+// Main loop: make set the one drawn and measured, then have everything rewrapped for it.
+void activate_glyph_set(GlyphSet* set) {
+    if (!set->atlas && !set->atlas_failed) set->atlas_failed = build_glyph_atlas(r, set) != 0;
+    glyph_set = set;
+    glyphs = set->glyphs;
+    glyph_atlas = set->atlas;
+    glyph_max_height = set->max_height;
+    line_height = set->line_height;
+    SDL_AtomicSetPtr((void**)&advance_table, set->advance_table);
+
+    // Non-ASCII glyphs and advances were for the old size.
+    SDL_LockMutex(font_lock);
+    if (font) TTF_CloseFont(font);
+    font = NULL;
+    unicode_font_failed = false;
+    unicode_clear();
+    loaded_font_size = set->size;
+    SDL_UnlockMutex(font_lock);
+
+    line_cache_clear();
+    SDL_AtomicAdd(&wrap_serial, 1);
+    rewrap_needed = true;
+    if (DEBUG) printf("Glyph set %dpt live (line height %d)\n", set->size, set->line_height);
+}
+
+// Main loop: move towards zoom_size. A size not built yet is built on a worker thread while the
+// live one keeps drawing. Returns true when a new set went live.
+bool poll_glyph_sets() {
+    if (glyph_set_building) {
+        if (!SDL_AtomicGet(&glyph_set_building->built)) return false;
+        GlyphSet* set = glyph_set_building;
+        glyph_set_building = NULL;
+        SDL_WaitThread(set->builder, NULL);
+        set->builder = NULL;
+        if (set->status != 0) {
+            fprintf(stderr, "Zoom to %dpt failed\n", set->size);
+            free_glyph_set(set);
+            zoom_size = glyph_set->size;
+            return false;
+        }
+        set->next = glyph_sets;
+        glyph_sets = set;
+    }
+    if (zoom_size == glyph_set->size) return false;
+
+    for (GlyphSet* set = glyph_sets; set; set = set->next) {
+        if (set->size == zoom_size) {
+            activate_glyph_set(set);
+            return true;
+        }
+    }
+    GlyphSet* set = new_glyph_set(zoom_size);
+    if (!set) return false;
+    set->builder = SDL_CreateThread(glyph_set_thread, "glyphs", set);
+    if (!set->builder) {
+        fprintf(stderr, "Glyph thread failed: %s\n", SDL_GetError());
+        free(set);
+        zoom_size = glyph_set->size;
+        return false;
+    }
+    glyph_set_building = set;
+    return false;
+}
+
+int load_font(char *path, int size)
+{
+    loaded_font_path = path;
+    loaded_font_size = size;
+    base_font_size = size > 0 ? size : 1;
+    zoom_size = size;
+
+    GlyphSet* set = new_glyph_set(size);
+    if (!set) return 1;
+    if (build_glyph_set(set) != 0) {
+        free(set);
+        return 1;
+    }
+    glyph_sets = set;
+    activate_glyph_set(set);
+
+    if (glyph_atlas) line_cache_init(r);
+    else line_cache_cap = 0;
+
+    return 0;
+}
+
+void flush_point_batch(SDL_Renderer* r, int slot, int alpha) {
+    PointBatch* b = &point_batches[slot][alpha];
+    if (b->count == 0) return;
+    Color c = palette[slot];
+    SDL_SetRenderDrawColor(r, c.r, c.g, c.b, (uint8_t)alpha);
+    if (SDL_RenderDrawPoints(r, b->points, b->count) != 0) {
+        if (DEBUG) fprintf(stderr, "DrawPoints failed (%d points): %s\n", b->count, SDL_GetError());
+    }
+    points_drawn += b->count;
+    b->count = 0;
+}
+
+// Send everything queued by render_gmap. One draw call per used color/alpha pair.
+void flush_point_batches(SDL_Renderer* r) {
+    for (int slot = 0; slot < palette_size; slot++) {
+        for (int alpha = 0; alpha < 256; alpha++) {
+            flush_point_batch(r, slot, alpha);
+        }
+    }
+}
+
+// Advance the animation clock to now. Returns the step in seconds.
+float clock_tick() {
+    Uint64 now = SDL_GetPerformanceCounter();
+    float dt = clock_last ? (float)((double)(now - clock_last) / SDL_GetPerformanceFrequency()) : 0;
+    clock_last = now;
+    if (dt > MAX_FRAME_TIME) dt = MAX_FRAME_TIME;
+    clock_now += dt;
+    return dt;
+}
+
+// Move the whole-screen jitter on by dt seconds, however many glyphs that frame draws. Entry
+// transitions follow clock_now by themselves.
+void animate(float dt) {
+    if (RATE > RATE_SETTLED) {
+        RATE -= RATE_DECAY * dt;
+        if (RATE < RATE_SETTLED) RATE = RATE_SETTLED;
+    }
+}
+
+// Sleep off what is left of this frame at target_fps. A late frame starts the next one from now
+// instead of rushing to catch up.
+void frame_wait() {
+    if (target_fps <= 0) return;
+    Uint64 freq = SDL_GetPerformanceFrequency();
+    Uint64 period = freq / target_fps;
+    Uint64 now = SDL_GetPerformanceCounter();
+    if (frame_deadline == 0 || now > frame_deadline + period) frame_deadline = now;
+    frame_deadline += period;
+    if (frame_deadline > now) SDL_Delay((Uint32)((frame_deadline - now) * 1000 / freq));
+}
+
+// Same seed, same jitter: benchmark runs are repeatable.
+void jitter_seed(uint32_t seed) {
+    for (int lane = 0; lane < 4; lane++) {
+        // splitmix32 spreads nearby seeds apart; xorshift needs a nonzero state.
+        uint32_t z = seed + 0x9e3779b9u * (uint32_t)(lane + 1);
+        z = (z ^ (z >> 16)) * 0x85ebca6bu;
+        z = (z ^ (z >> 13)) * 0xc2b2ae35u;
+        z ^= z >> 16;
+        jitter_state[lane] = z ? z : 1;
+    }
+    jitter_next = JITTER_BATCH;
+}
+
+// Make the next JITTER_BATCH offset pairs for range = (int)rate. Each 32-bit draw is one pair:
+// both halves scaled into [0, range) and centered, as rand() % RATE - RATE / 2 used to be.
+void jitter_fill(int range) {
+    if (range < 1) range = 1;
+    if (range > 65535) range = 65535;
+    int half = range / 2;
+    jitter_range = range;
+    jitter_next = 0;
+#ifdef __SSE2__
+    __m128i state = _mm_loadu_si128((const __m128i*)jitter_state);
+    __m128i scale = _mm_set1_epi16((short)range);  // Read as unsigned by mulhi_epu16.
+    __m128i center = _mm_set1_epi16((short)half);
+    for (int i = 0; i < JITTER_BATCH; i += 4) {
+        state = _mm_xor_si128(state, _mm_slli_epi32(state, 13));
+        state = _mm_xor_si128(state, _mm_srli_epi32(state, 17));
+        state = _mm_xor_si128(state, _mm_slli_epi32(state, 5));
+        __m128i offsets = _mm_sub_epi16(_mm_mulhi_epu16(state, scale), center);
+        _mm_storeu_si128((__m128i*)&jitter_offsets[2 * i], offsets);
+    }
+    _mm_storeu_si128((__m128i*)jitter_state, state);
+#else
+    for (int i = 0; i < JITTER_BATCH; i += 4) {
+        for (int lane = 0; lane < 4; lane++) {
+            uint32_t v = jitter_state[lane];
+            v ^= v << 13;
+            v ^= v >> 17;
+            v ^= v << 5;
+            jitter_state[lane] = v;
+            jitter_offsets[2 * (i + lane)] = (int16_t)((int)(((v & 0xffff) * (uint32_t)range) >> 16) - half);
+            jitter_offsets[2 * (i + lane) + 1] = (int16_t)((int)(((v >> 16) * (uint32_t)range) >> 16) - half);
+        }
+    }
+#endif
+}
+
+// Queue a glyph jittered by rate and faded to fade / 256. Points are grouped by color and alpha
+// and drawn by flush_point_batches.
+void render_gmap(SDL_Renderer* r, const GMap* g, int x, int y, int color, float rate, int fade) {
+    if (g->num_pixels == 0 || !g->pixels) {
+        if (DEBUG) printf("Skipping empty glyph\n");
+        return;
+    }
+
+    int range = (int)rate;
+    if (range != jitter_range) jitter_fill(range);  // Leftover offsets are for another rate.
+
+    // Set color with alpha (blends on black bg)
+    int slot = color;
+    int queued_points = 0;
+    for (int i = 0; i < g->num_pixels; ++i) {
+        const Pixel* p = &g->pixels[i];
+        int alpha = (fade < 256) ? (p->a * fade) >> 8 : p->a;
+        PointBatch* b = &point_batches[slot][alpha];
+        if (!b->points) {
+            b->points = (SDL_Point*)malloc(POINT_BATCH_SIZE * sizeof(SDL_Point));
+            if (!b->points) continue;
+        }
+
+        //Rand Offset
+        if (jitter_next == JITTER_BATCH) jitter_fill(range);
+        const int16_t* off = &jitter_offsets[2 * jitter_next++];
+
+        b->points[b->count].x = x + p->x + off[0];
+        b->points[b->count].y = y + p->y + off[1];
+        b->count++;
+        queued_points++;
+        if (b->count == POINT_BATCH_SIZE) flush_point_batch(r, slot, alpha);
+    }
+
+    if (DEBUG) printf("Queued glyph: %d points\n", queued_points);
+}
+
+void tint_glyph_atlas(int color) {
+    Color c = palette[color];
+    SDL_SetTextureColorMod(glyph_atlas, c.r, c.g, c.b);
+}
+
+// Settled path: one textured quad per glyph from the atlas, tinted by tint_glyph_atlas.
+void render_glyph_static(SDL_Renderer* r, int ch, int x, int y) {
+    SDL_Rect dst = {x, y, glyphs[ch].width, glyphs[ch].height};
+    SDL_RenderCopy(r, glyph_atlas, &glyphs[ch].atlas, &dst);
+}
+
+// Clear and draw the entries on screen at view_y_offset; the caller presents.
+void draw_chat_log(SDL_Renderer* r, int view_y_offset) {
+    SDL_SetRenderDrawColor(r, 0, 0, 0, 255);
+    SDL_RenderClear(r);
+
+    // Render chat log from the first entry on screen; jittered glyphs may stray rate / 2 past the edges.
+    int render_x = MARGIN_X;
+    int jitter = (int)((RATE > RATE_RESET ? RATE : RATE_RESET) / 2) + 1;
+    int clip_top = -jitter;
+    int clip_bottom = screen_height + jitter;
+    int top = view_y_offset - MARGIN_Y + clip_top - glyph_max_height;
+    int entry_idx = (top > 0) ? chat_index_at(top) : 0;
+    int current_y = MARGIN_Y - view_y_offset + chat_height_before(entry_idx);  // Apply scroll.
+    if (history.viewing) {
+        // Scrolled up past chat_log: paged-in entries first, then chat_log below them if they reach it.
+        current_y = MARGIN_Y - history.top_y;
+        for (int i = history.top; i < history.count && current_y < clip_bottom; i++) {
+            current_y = render_chat_entry(r, history_at(i), render_x, current_y, clip_top, clip_bottom);
+        }
+        entry_idx = history.attached ? 0 : chat_log_size;
+    }
+    for (; entry_idx < chat_log_size && current_y < clip_bottom; entry_idx++) {
+        current_y = render_chat_entry(r, chat_at(entry_idx), render_x, current_y, clip_top, clip_bottom);
+    }
+    flush_point_batches(r);
+}
+
+// Start timing a frame. Frames that turn out to have nothing to draw are just begun again.
+void profile_begin() {
+    if (!profiling) return;
+    profile_last = SDL_GetPerformanceCounter();
+    profile_points = points_drawn;
+    profile_glyphs = glyphs_drawn;
+    profile_cached = cached_entries_drawn;
+}
+
+// Close stage: it ran from the previous mark (or profile_begin) until now.
+void profile_mark(int stage) {
+    if (!profiling) return;
+    Uint64 now = SDL_GetPerformanceCounter();
+    profile_current.stage_us[stage] = (float)((double)(now - profile_last) * 1e6 / SDL_GetPerformanceFrequency());
+    profile_last = now;
+}
+
+// Skip whatever ran since the last mark, such as drawing the HUD itself.
+void profile_skip() {
+    if (profiling) profile_last = SDL_GetPerformanceCounter();
+}
+
+void profile_end() {
+    if (!profiling) return;
+    FrameSample* sample = &profile_current;
+    sample->frame = profile_frames;
+    sample->points = (uint32_t)(points_drawn - profile_points);
+    sample->glyphs = (uint32_t)(glyphs_drawn - profile_glyphs);
+    sample->cached = (uint32_t)(cached_entries_drawn - profile_cached);
+    profile_ring[profile_frames++ % PROFILE_SAMPLES] = *sample;
+    if (profile_csv) {
+        fprintf(profile_csv, "%u", sample->frame);
+        for (int stage = 0; stage < PROFILE_STAGES; stage++) fprintf(profile_csv, ",%.1f", sample->stage_us[stage]);
+        fprintf(profile_csv, ",%u,%u,%u\n", sample->points, sample->glyphs, sample->cached);
+    }
+    memset(sample, 0, sizeof(FrameSample));
+}
+
+int open_profile_csv(const char* path) {
+    profile_csv = fopen(path, "w");
+    if (!profile_csv) {
+        fprintf(stderr, "Profile CSV %s: %s\n", path, strerror(errno));
+        return 1;
+    }
+    fprintf(profile_csv, "frame");
+    for (int stage = 0; stage < PROFILE_STAGES; stage++) fprintf(profile_csv, ",%s_us", stage_names[stage]);
+    fprintf(profile_csv, ",points,glyphs,cached_entries\n");
+    profiling = true;
+    return 0;
+}
+
+// One line of ASCII in the live glyph set, settled.
+void draw_hud_text(SDL_Renderer* r, int x, int y, const char* text) {
+    for (const unsigned char* s = (const unsigned char*)text; *s; s++) {
+        int c = *s;
+        if (c > 32 && c < 127 && glyphs[c].num_pixels > 0) {
+            if (glyph_atlas) render_glyph_static(r, c, x, y);
+            else render_gmap(r, &glyphs[c], x, y, PALETTE_SPEAKER, RATE_SETTLED, 256);
+        }
+        x += get_advance(c);
+    }
+}
+
+// Mean and worst of each stage over the frames sampled since the HUD went on, top right.
+// Returns false if there are none yet.
+bool draw_profile_hud(SDL_Renderer* r) {
+    uint32_t sampled = profile_frames - profile_hud_from;
+    int count = sampled < PROFILE_SAMPLES ? (int)sampled : PROFILE_SAMPLES;
+    if (count == 0) return false;
+    double mean[PROFILE_STAGES] = {0}, worst[PROFILE_STAGES] = {0}, frame_mean = 0, frame_worst = 0;
+    double points = 0, glyph_count = 0, cached = 0;
+    for (int i = 0; i < count; i++) {
+        const FrameSample* sample = &profile_ring[(profile_frames - count + i) % PROFILE_SAMPLES];
+        double frame = 0;
+        for (int stage = 0; stage < PROFILE_STAGES; stage++) {
+            mean[stage] += sample->stage_us[stage];
+            if (sample->stage_us[stage] > worst[stage]) worst[stage] = sample->stage_us[stage];
+            frame += sample->stage_us[stage];
+        }
+        frame_mean += frame;
+        if (frame > frame_worst) frame_worst = frame;
+        points += sample->points;
+        glyph_count += sample->glyphs;
+        cached += sample->cached;
+    }
+
+    char lines[PROFILE_STAGES + 3][64];
+    int num_lines = 0;
+    snprintf(lines[num_lines++], sizeof(lines[0]), "%d frames  mean/max ms", count);
+    for (int stage = 0; stage < PROFILE_STAGES; stage++) {
+        snprintf(lines[num_lines++], sizeof(lines[0]), "%-8s %6.2f %6.2f", stage_names[stage], mean[stage] / count / 1e3, worst[stage] / 1e3);
+    }
+    snprintf(lines[num_lines++], sizeof(lines[0]), "%-8s %6.2f %6.2f", "total", frame_mean / count / 1e3, frame_worst / 1e3);
+    snprintf(lines[num_lines++], sizeof(lines[0]), "%.0f pts %.0f glyphs %.0f cached", points / count, glyph_count / count, cached / count);
+
+    int width = 0;
+    for (int i = 0; i < num_lines; i++) {
+        int line_width = 0;
+        for (const char* s = lines[i]; *s; s++) line_width += get_advance((unsigned char)*s);
+        if (line_width > width) width = line_width;
+    }
+    SDL_Rect box = {screen_width - width - 3 * MARGIN_X, MARGIN_Y, width + 2 * MARGIN_X, num_lines * line_height + 2 * MARGIN_Y};
+    SDL_SetRenderDrawColor(r, 0, 0, 0, 0xC0);
+    SDL_RenderFillRect(r, &box);
+    if (glyph_atlas) tint_glyph_atlas(PALETTE_SPEAKER);
+    for (int i = 0; i < num_lines; i++) draw_hud_text(r, box.x + MARGIN_X, box.y + MARGIN_Y + i * line_height, lines[i]);
+    flush_point_batches(r);
+    return true;
+}
+
+int64_t monotonic_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// A tagged entry is in this frame with a non-zero fade: it counts as shown once the frame is presented.
+void latency_note_drawn(ChatEntry* entry) {
+    if (latency_drawn_count == latency_drawn_cap) {
+        int cap = latency_drawn_cap ? latency_drawn_cap * 2 : 64;
+        int64_t* grown = (int64_t*)realloc(latency_drawn, cap * sizeof(int64_t));
+        if (!grown) return;
+        latency_drawn = grown;
+        latency_drawn_cap = cap;
+    }
+    latency_drawn[latency_drawn_count++] = entry->tag_ns;
+    entry->tag_ns = 0;
+}
+
+// Right after SDL_RenderPresent.
+void latency_presented() {
+    if (latency_drawn_count == 0) return;
+    int64_t now = monotonic_ns();
+    for (int i = 0; i < latency_drawn_count; i++) {
+        if (latency_count == latency_cap) {
+            int cap = latency_cap ? latency_cap * 2 : 1024;
+            uint32_t* grown = (uint32_t*)realloc(latency_us, cap * sizeof(uint32_t));
+            if (!grown) break;
+            latency_us = grown;
+            latency_cap = cap;
+        }
+        int64_t us = (now - latency_drawn[i]) / 1000;
+        latency_us[latency_count++] = us < 0 ? 0 : (us > UINT32_MAX ? UINT32_MAX : (uint32_t)us);
+    }
+    latency_drawn_count = 0;
+}
+
+int compare_uint32(const void* a, const void* b) {
+    uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
+    return (x > y) - (x < y);
+}
+
+// Percentiles and a histogram of append-to-present latency, at exit. A line counts as presented
+// on the first frame it is drawn with a non-zero fade, not the frame it was linked on.
+void latency_report() {
+    printf("Latency (append to the first present with non-zero fade): %d lines shown, %d never shown\n", latency_count, latency_tagged - latency_count);
+    if (latency_count == 0) return;
+    qsort(latency_us, latency_count, sizeof(uint32_t), compare_uint32);
+    printf("  min %.2f ms  p50 %.2f ms  p90 %.2f ms  p99 %.2f ms  max %.2f ms\n", latency_us[0] / 1e3,
+           latency_us[latency_count / 2] / 1e3, latency_us[(int64_t)latency_count * 9 / 10] / 1e3,
+           latency_us[(int64_t)latency_count * 99 / 100] / 1e3, latency_us[latency_count - 1] / 1e3);
+
+    // Rows double from 1 ms; the last takes everything slower.
+    int buckets[LATENCY_BUCKETS] = {0};
+    int most = 0;
+    for (int i = 0; i < latency_count; i++) {
+        int b = 0;
+        while (b < LATENCY_BUCKETS - 1 && latency_us[i] >= (1000u << b)) b++;
+        if (++buckets[b] > most) most = buckets[b];
+    }
+    for (int b = 0; b < LATENCY_BUCKETS; b++) {
+        char label[32];
+        if (b == 0) snprintf(label, sizeof(label), "< 1 ms");
+        else if (b == LATENCY_BUCKETS - 1) snprintf(label, sizeof(label), ">= %d ms", 1 << (b - 1));
+        else snprintf(label, sizeof(label), "%d-%d ms", 1 << (b - 1), 1 << b);
+        int bar = (buckets[b] * 50 + most - 1) / most;
+        printf("  %-12s %8d %.*s\n", label, buckets[b], bar, "##################################################");
+    }
+}
+
+int max_view_offset() {
+    int visible_height = screen_height - 2 * MARGIN_Y;
+    return (chat_log_height > visible_height) ? chat_log_height - visible_height : 0;
+}
+
+// Lines of a benchmark corpus, for --bench-wrap and --bench. Returns NULL if it can't be read or is empty.
+char** read_corpus(const char* path, int* out_lines, size_t* out_bytes) {
+    FILE* f = fopen(path, "r");
+    if (!f) {
+        fprintf(stderr, "Bench corpus %s: %s\n", path, strerror(errno));
+        return NULL;
+    }
+    char** lines = NULL;
+    int num_lines = 0, cap = 0;
+    size_t bytes = 0;
+    char buffer[LINE_BUFFER];
+    while (fgets(buffer, sizeof(buffer), f)) {
+        buffer[strcspn(buffer, "\n")] = '\0';
+        if (num_lines == cap) {
+            cap = cap ? cap * 2 : 1024;
+            char** grown = (char**)realloc(lines, cap * sizeof(char*));
+            if (!grown) break;
+            lines = grown;
+        }
+        lines[num_lines] = strdup(buffer);
+        if (!lines[num_lines]) break;
+        bytes += strlen(buffer);
+        num_lines++;
+    }
+    fclose(f);
+    if (num_lines == 0) {
+        fprintf(stderr, "Bench corpus %s is empty\n", path);
+        free(lines);
+        return NULL;
+    }
+    *out_lines = num_lines;
+    *out_bytes = bytes;
+    return lines;
+}
+
+void free_corpus(char** lines, int num_lines) {
+    for (int i = 0; i < num_lines; i++) free(lines[i]);
+    free(lines);
+}
+
+// --bench-wrap: time wrap_text against wrap_text_reference over every line of a corpus file.
+int bench_wrap(const char* path) {
+    int num_lines;
+    size_t bytes;
+    char** lines = read_corpus(path, &num_lines, &bytes);
+    if (!lines) return 1;
+
+    // Same output apart from words wider than a line, which only wrap_text breaks.
+    LineSpan a[LINE_BUFFER], b[LINE_BUFFER];
+    int differ = 0;
+    for (int i = 0; i < num_lines; i++) {
+        int na = wrap_text(lines[i], MAX_WRAP_WIDTH, a, LINE_BUFFER);
+        int nb = wrap_text_reference(lines[i], MAX_WRAP_WIDTH, b, LINE_BUFFER);
+        if (na != nb || memcmp(a, b, na * sizeof(LineSpan)) != 0) differ++;
+    }
+
+    int rounds = (int)(50000000 / (bytes + 1)) + 1;  // About 50 MB of text per run.
+    const char* names[2] = {"wrap_text", "wrap_text_reference"};
+    for (int which = 0; which < 2; which++) {
+        long wrapped = 0;
+        Uint64 start = SDL_GetPerformanceCounter();
+        for (int round = 0; round < rounds; round++) {
+            for (int i = 0; i < num_lines; i++) {
+                wrapped += which == 0 ? wrap_text(lines[i], MAX_WRAP_WIDTH, a, LINE_BUFFER)
+                                      : wrap_text_reference(lines[i], MAX_WRAP_WIDTH, a, LINE_BUFFER);
+            }
+        }
+        double seconds = (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+        double total_lines = (double)num_lines * rounds;
+        printf("%-20s %8.1f ns/line %8.1f MB/s (%ld wrapped lines)\n", names[which],
+               seconds * 1e9 / total_lines, bytes * (double)rounds / seconds / 1e6, wrapped / rounds);
+    }
+    printf("%d lines, %zu bytes, %d wrapped differently\n", num_lines, bytes, differ);
+
+    free_corpus(lines, num_lines);
+    return 0;
+}
+
+int compare_doubles(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+// Headless run over a replayed log (--bench): wrap_text and ingest throughput, then frames drawn
+// with BENCH_LINES_PER_FRAME new lines each. The animation clock steps a fixed BENCH_FRAME_TIME
+// per frame, so runs with the same seed draw the same points.
+int bench(const char* path, int frames) {
+    int num_lines;
+    size_t bytes;
+    char** lines = read_corpus(path, &num_lines, &bytes);
+    if (!lines) return 1;
+    double freq = (double)SDL_GetPerformanceFrequency();
+    printf("%s: %d lines, %zu bytes, scrollback %d, %dx%d\n", path, num_lines, bytes, max_entries, screen_width, screen_height);
+
+    // wrap_text on its own, at the window's width.
+    LineSpan spans[LINE_BUFFER];
+    int width = SDL_AtomicGet(&wrap_width);
+    int rounds = (int)(20000000 / (bytes + 1)) + 1;  // About 20 MB of text.
+    long wrapped = 0;
+    Uint64 start = SDL_GetPerformanceCounter();
+    for (int round = 0; round < rounds; round++) {
+        for (int i = 0; i < num_lines; i++) wrapped += wrap_text(lines[i], width, spans, LINE_BUFFER);
+    }
+    double seconds = (SDL_GetPerformanceCounter() - start) / freq;
+    printf("wrap_text        %12.0f lines/s %8.1f MB/s (%ld wrapped lines)\n",
+           (double)num_lines * rounds / seconds, bytes * (double)rounds / seconds / 1e6, wrapped / rounds);
+
+    // Ingest: what the ingest thread and drain_ingest do per line, evicting once scrollback is full.
+    start = SDL_GetPerformanceCounter();
+    for (int i = 0; i < num_lines; i++) {
+        ChatEntry* entry = new_chat_entry(lines[i], true, PALETTE_SPEAKER);
+        if (entry) add_chat_entry(entry);
+    }
+    seconds = (SDL_GetPerformanceCounter() - start) / freq;
+    printf("add_chat_entry   %12.0f lines/s (new_chat_entry included)\n", num_lines / seconds);
+
+    // Frames, following the tail like the main loop.
+    double* times = (double*)malloc(frames * sizeof(double));
+    if (!times) {
+        free_corpus(lines, num_lines);
+        return 1;
+    }
+    uint64_t points_before = points_drawn;
+    double total = 0;
+    for (int frame = 0; frame < frames; frame++) {
+        start = SDL_GetPerformanceCounter();
+        clock_now += BENCH_FRAME_TIME;
+        animate(BENCH_FRAME_TIME);
+        for (int k = 0; k < BENCH_LINES_PER_FRAME; k++) {
+            ChatEntry* entry = new_chat_entry(lines[(frame * BENCH_LINES_PER_FRAME + k) % num_lines], true, PALETTE_SPEAKER);
+            if (entry) add_chat_entry(entry);
+        }
+        chat_log_evicted = 0;
+        draw_chat_log(r, max_view_offset());
+        SDL_RenderPresent(r);
+        times[frame] = (SDL_GetPerformanceCounter() - start) / freq;
+        total += times[frame];
+    }
+    qsort(times, frames, sizeof(double), compare_doubles);
+    printf("frame time       p50 %.3f ms  p90 %.3f ms  p99 %.3f ms  max %.3f ms (%d frames)\n",
+           times[frames / 2] * 1e3, times[frames * 9 / 10] * 1e3, times[frames * 99 / 100] * 1e3,
+           times[frames - 1] * 1e3, frames);
+    printf("points drawn     %12.0f points/s (%llu in all)\n", (points_drawn - points_before) / total,
+           (unsigned long long)(points_drawn - points_before));
+
+    free(times);
+    free_corpus(lines, num_lines);
+    return 0;
+}
+
+// Parse a whole number in [min, max] for option name into *value.
+int parse_int_arg(const char* name, const char* arg, int min, int max, int* value) {
+    char* end = NULL;
+    errno = 0;
+    long n = strtol(arg, &end, 10);
+    if (errno || end == arg || *end || n < min || n > max) {
+        fprintf(stderr, "Bad %s '%s' (want %d to %d)\n", name, arg, min, max);
+        return 1;
+    }
+    *value = (int)n;
+    return 0;
+}
+
+int main(int argc, char* argv[]) 
+{ 
+    // Usage: tc [--cache-mb N] [--scrollback N] [--seed N] [--fps N] [--speaker NAME=RRGGBB]... [--bench-wrap corpus.txt]
+    //           [--bench corpus.txt [--bench-frames N]] [--profile-csv out.csv] [--latency] [--merge arrival|time]
+    //           [font.ttf [size [log.txt | 'logs/*.txt']...]]
+    char* args[2] = {NULL, NULL};
+    const char* bench_wrap_path = NULL;
+    const char* bench_path = NULL;  // Headless: no window on screen, software rendering.
+    int bench_frames = BENCH_FRAMES;
+    uint32_t seed = JITTER_SEED;
+    int nargs = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--cache-mb") == 0 && i + 1 < argc) {
+            if (set_line_cache_mb(argv[++i]) != 0) return 1;
+        }
+        else if (strcmp(argv[i], "--scrollback") == 0 && i + 1 < argc) {
+            if (parse_int_arg("--scrollback", argv[++i], 1, MAX_SCROLLBACK, &max_entries) != 0) return 1;
+        }
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) seed = (uint32_t)strtoul(argv[++i], NULL, 0);
+        else if (strcmp(argv[i], "--fps") == 0 && i + 1 < argc) {
+            if (parse_int_arg("--fps", argv[++i], 0, MAX_FPS, &target_fps) != 0) return 1;
+        }
+        else if (strcmp(argv[i], "--speaker") == 0 && i + 1 < argc) {
+            if (add_speaker(argv[++i]) != 0) return 1;
+        }
+        else if (strcmp(argv[i], "--bench-wrap") == 0 && i + 1 < argc) bench_wrap_path = argv[++i];
+        else if (strcmp(argv[i], "--bench") == 0 && i + 1 < argc) bench_path = argv[++i];
+        else if (strcmp(argv[i], "--bench-frames") == 0 && i + 1 < argc) {
+            if (parse_int_arg("--bench-frames", argv[++i], 1, INT_MAX, &bench_frames) != 0) return 1;
+        }
+        else if (strcmp(argv[i], "--latency") == 0) {
+            latency_mode = true;
+            latency_start_ns = monotonic_ns();
+        }
+        else if (strcmp(argv[i], "--profile-csv") == 0 && i + 1 < argc) {
+            if (open_profile_csv(argv[++i]) != 0) return 1;
+        }
+        else if (strcmp(argv[i], "--merge") == 0 && i + 1 < argc) {
+            const char* mode = argv[++i];
+            if (strcmp(mode, "time") != 0 && strcmp(mode, "arrival") != 0) {
+                fprintf(stderr, "--merge takes 'arrival' or 'time', not '%s'\n", mode);
+                return 1;
+            }
+            merge_by_time = strcmp(mode, "time") == 0;
+        }
+        else if (nargs < 2) args[nargs++] = argv[i];
+        else if (add_source(argv[i]) != 0) return 1;  // Every argument after the size is a log.
+    }
+    if (num_sources == 0 && add_source("log.txt") != 0) return 1;
+
+    jitter_seed(seed);
+    chat_log = (ChatEntry**)calloc(max_entries, sizeof(ChatEntry*));
+    height_tree = (int*)calloc(max_entries + 1, sizeof(int));
+    while (height_tree_step * 2 <= max_entries) height_tree_step *= 2;
+    if (!chat_log || !height_tree) {
+        fprintf(stderr, "Scrollback of %d entries does not fit in memory\n", max_entries);
+        return 1;
+    }
+
+    if(nargs >= 1) params = true;
+    char *font_path;
+    int font_size = 16;
+    if(params == false) font_path = "fonts/Hack-Regular.ttf";
+    else font_path = args[0];
+    if(nargs >= 2) font_size = atoi(args[1]);
+
+    if (bench_path) setenv("SDL_VIDEODRIVER", "offscreen", 0);  // Unless the environment picks one.
+    if (SDL_Init(SDL_INIT_VIDEO) < 0) { fprintf(stderr, "SDL init failed: %s\n", SDL_GetError()); return 1; }
+    if (TTF_Init() < 0) { fprintf(stderr, "TTF init failed: %s\n", TTF_GetError()); SDL_Quit(); return 1; }
+    if (unicode_init() != 0) { fprintf(stderr, "Mutex creation failed: %s\n", SDL_GetError()); TTF_Quit(); SDL_Quit(); return 1; }
+
+    w = SDL_CreateWindow("tc", WX, WY, WW, WH, SDL_WINDOW_BORDERLESS);
+    if (!w) {
+        fprintf(stderr, "Window creation failed: %s\n", SDL_GetError());
+        TTF_Quit();
+        SDL_Quit();
+        return 1;
+    }
+    r = SDL_CreateRenderer(w, -1, bench_path ? SDL_RENDERER_SOFTWARE : SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
+    if (!r) {
+        fprintf(stderr, "Renderer creation failed: %s\n", SDL_GetError());
+        SDL_DestroyWindow(w);
+        TTF_Quit();
+        SDL_Quit();
+        return 1;
+    }
+    SDL_SetRenderDrawBlendMode(r, SDL_BLENDMODE_BLEND);
+
+    if(load_font(font_path, font_size) != 0) {
+        SDL_DestroyRenderer(r);
+        SDL_DestroyWindow(w);
+        TTF_Quit();
+        SDL_Quit();
+        return 1;
+    }
+
+    // Force space advance if zero
+    if (glyphs[32].advance == 0) {
+        glyphs[32].advance = SPACE_ADVANCE;
+        if (DEBUG) printf("Forced space advance to %d (was 0)\n", SPACE_ADVANCE);
+    }
+
+    if (bench_wrap_path) {
+        int status = bench_wrap(bench_wrap_path);
+        SDL_DestroyRenderer(r);
+        SDL_DestroyWindow(w);
+        TTF_Quit();
+        SDL_Quit();
+        return status;
+    }
+
+    arena_lock = SDL_CreateMutex();
+    if (!arena_lock) {
+        fprintf(stderr, "Mutex creation failed: %s\n", SDL_GetError());
+        SDL_DestroyRenderer(r);
+        SDL_DestroyWindow(w);
+        TTF_Quit();
+        SDL_Quit();
+        return 1;
+    }
+
+    if (bench_path) {
+        int status = bench(bench_path, bench_frames);
+        SDL_DestroyRenderer(r);
+        SDL_DestroyWindow(w);
+        TTF_Quit();
+        SDL_Quit();
+        return status;
+    }
+
+    // Initialize log file polling.
+    open_sources();
+
+    // From here on the ingest thread owns the sources; it watches even a missing log, so it is picked up once created.
+    if (ingest_start() != 0) {
+        fprintf(stderr, "Ingest thread failed: %s\n", SDL_GetError());
+        SDL_DestroyRenderer(r);
+        SDL_DestroyWindow(w);
+        TTF_Quit();
+        SDL_Quit();
+        return 1;
     }
 
+    int view_y_offset = 0;  // For scrolling
+    bool follow_tail = true;  // Stay on the newest entries until scrolled up.
+    bool paging_back = false;  // Scrolled up, or Up with all of chat_log on screen: page older lines in.
+
     int quit = false;
     SDL_Event e;
+    bool redraw = true;  // Screen content changed since the last present.
 
     while (!quit) {
+        // Idle: nothing new, no input and no animation. Sleep until an event or the next log poll.
+        bool animating = RATE >= JITTER_VISIBLE || clock_now < transitions_end;
+        bool working = rewrap.jobs || glyph_set_building;  // Background results to pick up.
+        if (!redraw && !animating) {
+            SDL_WaitEventTimeout(NULL, working ? DELAY : -1);
+            clock_last = 0;  // Nothing moved while idle.
+        }
+        float dt = clock_tick();
+
         while (SDL_PollEvent(&e)) {
             if (e.type == SDL_QUIT || (e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_ESCAPE)) {
                 quit = true;
             }
+            if (e.type == SDL_WINDOWEVENT || e.type == SDL_KEYDOWN) redraw = true;
             if (e.type == SDL_WINDOWEVENT && e.window.event == SDL_WINDOWEVENT_RESIZED) {
                 SDL_GetWindowSize(w, &screen_width, &screen_height);
+                line_cache_clear();
+                int width = screen_width - 2 * MARGIN_X;
+                if (width < 1) width = 1;
+                if (width != SDL_AtomicGet(&wrap_width)) {
+                    SDL_AtomicSet(&wrap_width, width);
+                    rewrap_needed = true;
+                }
 
                 // Re-clamp offset after resize
-                int total_height = get_total_chat_height();
-                int visible_height = screen_height - 2 * MARGIN_Y;
-                int max_offset = (total_height > visible_height) ? total_height - visible_height : 0;
+                int max_offset = max_view_offset();
                 if (view_y_offset > max_offset) {
                     view_y_offset = max_offset;
                 }
@@ -595,80 +3453,118 @@ int main(int argc, char* argv[])
             }
             // Simple scroll: Arrow keys (up/down for offset)
             if (e.type == SDL_KEYDOWN) {
-                if (e.key.keysym.sym == SDLK_UP) view_y_offset -= 50;
-                if (e.key.keysym.sym == SDLK_DOWN) view_y_offset += 50;
-
-                // Clamp offset.
-                int total_height = get_total_chat_height();
-                int visible_height = screen_height - 2 * MARGIN_Y;
-                int max_offset = (total_height > visible_height) ? total_height - visible_height : 0;
-                view_y_offset = (view_y_offset < 0) ? 0 : (view_y_offset > max_offset ? max_offset : view_y_offset);
+                if (e.key.keysym.sym == SDLK_UP || e.key.keysym.sym == SDLK_DOWN) {
+                    int dy = (e.key.keysym.sym == SDLK_UP) ? -50 : 50;
+                    if (history.viewing) history.top_y += dy;
+                    else view_y_offset += dy;
+                    history_view(&view_y_offset);  // Above chat_log: older lines paged in from the log.
+
+                    // Clamp offset. Scrolling back to the bottom follows new entries again.
+                    int max_offset = max_view_offset();
+                    view_y_offset = (view_y_offset < 0) ? 0 : (view_y_offset > max_offset ? max_offset : view_y_offset);
+                    follow_tail = !history.viewing && view_y_offset == max_offset;
+                    paging_back = !follow_tail || dy < 0;
+                }
 
                 if(e.key.keysym.sym == SDLK_e) RATE += RATE_RESET;
-                if(e.key.keysym.sym == SDLK_F1) { c2.r = rand() % 255; c2.g = rand() % 255; c2.b = rand() % 255; }
-                if(e.key.keysym.sym == SDLK_F2) { c1.r = rand() % 255; c1.g = rand() % 255; c1.b = rand() % 255; }
-                if(e.key.keysym.sym == SDLK_F3) { c2.r = 0x77; c2.g = 0x77; c2.b = 0x77; }
-                if(e.key.keysym.sym == SDLK_F4) { c1.r = 0x55; c1.g = 0x99; c1.b = 0xFF; }
+                if(e.key.keysym.sym == SDLK_p) {
+                    profile_hud = !profile_hud;
+                    profiling = profile_hud || profile_csv;
+                    if (profile_hud) profile_hud_from = profile_frames;  // Nothing from an earlier session.
+                }
+                if(e.key.keysym.sym == SDLK_EQUALS || e.key.keysym.sym == SDLK_PLUS || e.key.keysym.sym == SDLK_KP_PLUS) {
+                    zoom_size = (zoom_size + ZOOM_STEP > MAX_FONT_SIZE) ? MAX_FONT_SIZE : zoom_size + ZOOM_STEP;
+                }
+                if(e.key.keysym.sym == SDLK_MINUS || e.key.keysym.sym == SDLK_KP_MINUS) {
+                    zoom_size = (zoom_size - ZOOM_STEP < MIN_FONT_SIZE) ? MIN_FONT_SIZE : zoom_size - ZOOM_STEP;
+                }
+                Color* speaker = &palette[PALETTE_SPEAKER];
+                Color* body = &palette[PALETTE_BODY];
+                if(e.key.keysym.sym == SDLK_F1) { body->r = rand() % 255; body->g = rand() % 255; body->b = rand() % 255; }
+                if(e.key.keysym.sym == SDLK_F2) { speaker->r = rand() % 255; speaker->g = rand() % 255; speaker->b = rand() % 255; }
+                if(e.key.keysym.sym == SDLK_F3) { body->r = 0x77; body->g = 0x77; body->b = 0x77; }
+                if(e.key.keysym.sym == SDLK_F4) { speaker->r = 0x55; speaker->g = 0x99; speaker->b = 0xFF; }
+                if(e.key.keysym.sym >= SDLK_F1 && e.key.keysym.sym <= SDLK_F4) line_cache_clear();
 
             }
         }
 
-        // Poll for new log entr
-        if (log_file) {
-            poll_log_file(log_filepath);
+        // Link new log entries finished by the ingest thread
+        profile_begin();
+        if (drain_ingest()) redraw = true;
+        profile_mark(STAGE_INGEST);
+        if (poll_glyph_sets()) redraw = true;
+        // Rewrap after a resize: on-screen entries now, the rest as workers finish them
+        if (rewrap_needed) {
+            rewrap_start(&view_y_offset, follow_tail);
+            redraw = true;
         }
-
-
-        // Auto-scroll to bottom after polling
-        int total_height = get_total_chat_height();
-        int visible_height = screen_height - 2 * MARGIN_Y;
-        int max_offset = (total_height > visible_height) ? total_height - visible_height : 0;
-        view_y_offset = max_offset;
-
-
-        SDL_SetRenderDrawColor(r, 0, 0, 0, 255);
-        SDL_RenderClear(r);
-
-        // Render chat log
-        int render_x = MARGIN_X;
-        int current_y = MARGIN_Y - view_y_offset;  // Start from top, apply scroll.
-        for (int entry_idx = 0; entry_idx < chat_log_size; entry_idx++) {
-            ChatEntry* entry = chat_log[entry_idx];
-            if (!entry) continue;
-            if (current_y > screen_height + 100) break;  // Skip off-screen early.
-            if (current_y + entry->rendered_height < -100) {
-                current_y += entry->rendered_height;  // Skip if above view.
-                continue;
-            }
-            current_y = render_chat_entry(r, entry, render_x, current_y);
+        if (rewrap_commit(&view_y_offset)) redraw = true;
+        profile_mark(STAGE_WRAP);
+        animate(dt);
+        if (!redraw && RATE < JITTER_VISIBLE && clock_now >= transitions_end) continue;  // Nothing to draw.
+
+
+        // Auto-scroll to bottom after polling, or keep the same entries in view as older ones are evicted.
+        int max_offset = max_view_offset();
+        if (follow_tail) view_y_offset = max_offset;
+        else view_y_offset -= chat_log_evicted;
+        history_view(&view_y_offset);  // Evicted entries in view are in the history now; rewraps move it too.
+        view_y_offset = (view_y_offset < 0) ? 0 : (view_y_offset > max_offset ? max_offset : view_y_offset);
+        chat_log_evicted = 0;
+        if (!paging_back && history.count > 0) history_clear();  // Back at the bottom: let the pages go.
+        history_read_ahead(view_y_offset, paging_back);
+        profile_mark(STAGE_LAYOUT);
+
+        draw_chat_log(r, view_y_offset);
+        profile_mark(STAGE_DRAW);
+        bool hud_empty = false;
+        if (profile_hud) {
+            hud_empty = !draw_profile_hud(r);
+            profile_skip();
         }
-
         SDL_RenderPresent(r);
-        SDL_Delay(DELAY);
+        latency_presented();
+        profile_mark(STAGE_PRESENT);
+        profile_end();
+        redraw = hud_empty;  // Just turned on: it shows from the next frame, with this one's sample.
+        frame_wait();
     }
 
-    // Cleanup chat log
-    for (int i = 0; i < chat_log_size; i++) {
-        if (!chat_log[i]) continue;
-        ChatEntry* entry = chat_log[i];
-        for (int j = 0; j < entry->num_wrapped; j++) {
-            free(entry->wrapped_lines[j]);
-        }
-        free(entry->wrapped_lines);
-        free(entry->original_line);
-        free(entry);
-    }
+    ingest_stop();
+    rewrap_cancel();
+    if (latency_mode) latency_report();
+    free(latency_drawn);
+    free(latency_us);
+
+    // Cleanup chat log: the arena takes every entry with it.
+    line_cache_clear();
+    free(history.entries);
+    free(history.incoming);
     free(chat_log);
+    free(height_tree);
+    arena_free_all();
+    SDL_DestroyMutex(arena_lock);
+
+    for (int slot = 0; slot < PALETTE_SIZE; slot++) {
+        for (int alpha = 0; alpha < 256; alpha++) free(point_batches[slot][alpha].points);
+    }
 
     // Free GMap pixels
-    for (int c = 0; c < 128; c++) {
-        if (glyphs[c].pixels) {
-            free(glyphs[c].pixels);
-            glyphs[c].pixels = NULL;
-        }
+    if (glyph_set_building) {
+        SDL_WaitThread(glyph_set_building->builder, NULL);
+        free_glyph_set(glyph_set_building);
+    }
+    while (glyph_sets) {
+        GlyphSet* next = glyph_sets->next;
+        free_glyph_set(glyph_sets);
+        glyph_sets = next;
     }
-    if (log_file) fclose(log_file);
+    unicode_clear();
+    close_sources();
+    if (profile_csv) fclose(profile_csv);
     if (font) TTF_CloseFont(font);
+    SDL_DestroyMutex(font_lock);
     SDL_DestroyRenderer(r);
     SDL_DestroyWindow(w);
     TTF_Quit();